@@ -0,0 +1,840 @@
+/*
+benchmark.c
+Benchmark of the "getop_p.h" getopt() variants on synthetic command lines.
+SPDX-License-Identifier: Unlicense OR 0BSD
+
+On platforms with their own getopt() the portable implementation is built
+with GETOPT_P_FORCE_PORTABLE and also compared with the platform getopt().
+Build with -DGETOPT_P_THREAD_LOCAL to time getopt() on several threads at
+once without a mutex :
+
+    cc -O2 -DGETOPT_P_THREAD_LOCAL -o benchmark benchmark.c
+*/
+
+#define _POSIX_C_SOURCE 200809L     /* Platform getopt() from <unistd.h> */
+#define GETOPT_P_FORCE_PORTABLE
+#define GETOPT_P_IMPLEMENTATION
+#include "getopt_p.h"
+
+#ifndef _WIN32
+#include <getopt.h>                 /* Platform getopt_long() */
+#endif /* #ifndef _WIN32 */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#ifndef __STDC_NO_THREADS__
+#include <threads.h>
+#endif /* #ifndef __STDC_NO_THREADS__ */
+
+#define BENCH_ARGC_MIN 10           /* Fewest synthetic argv entries */
+#define BENCH_ARGC_MAX 1000000      /* Most synthetic argv entries */
+#define BENCH_ENTRIES 10000000L     /* Total argv entries parsed per timing */
+#define BENCH_RESULTS 4096          /* Records per getopt_p_parse_all() call */
+#define BENCH_RSP_BYTES (50L<<20)   /* Size of the response file benchmark */
+#define BENCH_RSP_ARGC 8000000      /* Most argv entries from response file */
+#define BENCH_LONG_MAX 1000         /* Most long options in a table */
+#define BENCH_LONG_ENTRIES 100000   /* Long options parsed per timing */
+#define BENCH_PERMUTE_ENTRIES 2000000L  /* Entries permuted per timing */
+#define BENCH_PERMUTE_PLATFORM 10000    /* Most entries for platform (n^2) */
+#define BENCH_RESETS 2000000L       /* Command lines parsed after a reset */
+#define BENCH_THREADS_MAX 16        /* Most threads parsing at once */
+#define BENCH_THREAD_LINES 4000000L /* Command lines parsed by all threads */
+#define BENCH_STREAM_BYTES (256L<<20)   /* Size of the streamed arguments */
+#define BENCH_STREAM_BUF (1L<<20)   /* Largest stream buffer */
+#define BENCH_CONVERSIONS 10000000L  /* Numbers converted per timing */
+#define BENCH_JOBS 4000             /* Command lines in a batch */
+#define BENCH_JOB_RESULTS 1000000   /* Records for all of the batch */
+
+/* Long option string, options used by the benchmark are near the end */
+static const char * long_opt_str =
+    ":abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXY0123456789Z:";
+
+static char * bench_argv[BENCH_ARGC_MAX+2];
+static getopt_p_table bench_table;
+static getopt_p_result bench_results[BENCH_RESULTS];
+static char * bench_rsp_argv[BENCH_RSP_ARGC];
+static unsigned long long bench_mask[4][GETOPT_P_SCAN_WORDS(BENCH_ARGC_MAX+1)];
+static char bench_long_names[BENCH_LONG_MAX][32];
+static char bench_long_abbrevs[BENCH_LONG_MAX][32];
+static getopt_p_option bench_longopts[3][BENCH_LONG_MAX+1];  /* Per size */
+static getopt_p_long_index bench_long_index;
+static char * bench_operands[BENCH_ARGC_MAX+1];
+static char bench_stream_buf[BENCH_STREAM_BUF];
+static getopt_p_job bench_jobs[BENCH_JOBS];
+static getopt_p_result bench_job_results[BENCH_JOB_RESULTS];
+#ifndef _WIN32
+static struct option bench_platform_longopts[BENCH_LONG_MAX+1];
+#endif /* #ifndef _WIN32 */
+
+typedef long (* bench_fn) (int argc, long repeat);
+
+double bench_seconds (void);
+void bench_setup (void);
+void bench_run (const char * name, bench_fn fn, int argc);
+long bench_getopt (int argc, long repeat);
+long bench_getopt_compiled (int argc, long repeat);
+long bench_parse_all (int argc, long repeat);
+void bench_scan (void);
+void bench_rsp (void);
+void bench_long (void);
+void bench_long_argv (int argc, char * names, int count);
+void bench_long_run (const getopt_p_option * longopts, int count, int argc,
+    const char * abbrev);
+void bench_long_print (const char * parser, const char * abbrev, int count,
+    long options, long wrong, double seconds);
+void bench_permute (void);
+void bench_permute_argv (int argc);
+void bench_reset (void);
+void bench_reset_print (const char * name, int argc, long options,
+    double seconds);
+void bench_stream (void);
+void bench_convert (void);
+#ifndef __STDC_NO_THREADS__
+void bench_threads (void);
+void bench_threads_run (const char * name, thrd_start_t fn, int threads);
+int bench_thread_mutex (void * arg);
+void bench_batch (void);
+int bench_batch_thread (void * arg);
+#ifdef GETOPT_P_THREAD_LOCAL
+int bench_thread_local (void * arg);
+#endif /* #ifdef GETOPT_P_THREAD_LOCAL */
+#endif /* #ifndef __STDC_NO_THREADS__ */
+#ifndef _WIN32
+long bench_platform_getopt (int argc, long repeat);
+#endif /* #ifndef _WIN32 */
+
+int main (void)
+{
+    GETOPT_P_NAME(opterr) = 0;
+    bench_setup();
+    (void)getopt_p_compile(&bench_table, long_opt_str);
+
+    printf("%-24s %9s %10s %8s %10s\n", "parser", "argc", "options",
+        "seconds", "ns/option");
+    for (int entries = BENCH_ARGC_MIN; entries <= BENCH_ARGC_MAX;
+        entries *= 10) {
+        int argc = entries + 1;     /* Program name plus synthetic entries */
+        bench_run("getopt()", bench_getopt, argc);
+        bench_run("getopt_compiled()", bench_getopt_compiled, argc);
+        bench_run("getopt_p_parse_all()", bench_parse_all, argc);
+#ifndef _WIN32
+        bench_run("platform getopt()", bench_platform_getopt, argc);
+#endif /* #ifndef _WIN32 */
+    }
+    bench_scan();
+    bench_rsp();
+    bench_long();
+    bench_permute();
+    bench_reset();
+    bench_stream();
+    bench_convert();
+#ifndef __STDC_NO_THREADS__
+    bench_threads();
+    bench_batch();
+#endif /* #ifndef __STDC_NO_THREADS__ */
+
+    exit(EXIT_SUCCESS);
+}
+
+double bench_seconds (void)
+{
+    struct timespec ts;
+    (void)timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void bench_setup (void)
+{
+    /* Alternate option clusters with options taking a separate argument */
+    bench_argv[0] = "benchmark";
+    for (int i = 1; i <= BENCH_ARGC_MAX; i++) {
+        switch (i % 3) {
+        case 1 :
+            bench_argv[i] = "-9876543210";
+            break;
+        case 2 :
+            bench_argv[i] = "-Z";
+            break;
+        default :
+            bench_argv[i] = "value";
+        }
+    }
+    return;
+}
+
+void bench_run (const char * name, bench_fn fn, int argc)
+{
+    /* Parse the same total number of argv entries for every argc */
+    long repeat = BENCH_ENTRIES / (argc - 1);
+    char * saved = bench_argv[argc];
+    bench_argv[argc] = NULL;
+
+    double start = bench_seconds();
+    long options = fn(argc, repeat);
+    double seconds = bench_seconds() - start;
+
+    bench_argv[argc] = saved;
+    printf("%-24s %9d %10ld %8.3f %10.2f\n", name, argc, options, seconds,
+        (options > 0) ? (seconds * 1e9 / (double)options) : 0.0);
+    return;
+}
+
+/* Baseline : getopt() searching the option string on every option */
+long bench_getopt (int argc, long repeat)
+{
+    long options = 0;
+    for (long r = 0; r < repeat; r++) {
+        GETOPT_P_NAME(optind) = 1;
+        while (GETOPT_P_NAME(getopt)(argc, bench_argv, long_opt_str) != -1) {
+            options++;
+        }
+    }
+    return options;
+}
+
+/* Option string compiled once into a lookup table */
+long bench_getopt_compiled (int argc, long repeat)
+{
+    long options = 0;
+    for (long r = 0; r < repeat; r++) {
+        GETOPT_P_NAME(optind) = 1;
+        while (getopt_compiled(argc, bench_argv, &bench_table) != -1) {
+            options++;
+        }
+    }
+    return options;
+}
+
+/* Every option of argv parsed in to an array of records */
+long bench_parse_all (int argc, long repeat)
+{
+    long options = 0;
+    for (long r = 0; r < repeat; r++) {
+        getopt_p_state state = GETOPT_P_STATE_INIT;
+        int len;
+        state.opterr = 0;
+        while (getopt_p_parse_all(&state, argc, bench_argv, &bench_table,
+            bench_results, BENCH_RESULTS, &len) == -1) {
+            options += len;
+        }
+        options += len;
+    }
+    return options;
+}
+
+/* Bulk classification of argv entries, against comparing each entry */
+void bench_scan (void)
+{
+    /* Operands mixed irregularly with options, "-" and "--" */
+    static const char * kinds[8] = { "file.txt", "-v", "value", "-",
+        "dir/file", "--", "-9876543210", "x" };
+    char ** argv = bench_rsp_argv;
+    int argc = BENCH_ARGC_MAX + 1;
+    unsigned seed = 1;
+    for (int i = 0; i < argc; i++) {
+        seed = seed * 1103515245u + 12345u;
+        argv[i] = (char *)kinds[(seed >> 16) % 8];
+    }
+    int repeat = BENCH_ENTRIES / argc;
+
+    long options = 0;
+    double start = bench_seconds();
+    for (int r = 0; r < repeat; r++) {
+        options = 0;
+        for (int i = 0; i < argc; i++) {
+            const char * arg = argv[i];
+            if (arg[0] == '-' && strcmp(arg, "-") != 0 &&
+                strcmp(arg, "--") != 0) {
+                options++;
+            }
+        }
+    }
+    double seconds = bench_seconds() - start;
+    printf("\n%-24s %9d %10ld %8.3f %10.2f ns/entry\n", "strcmp() classify",
+        argc, options, seconds, seconds * 1e9 / ((double)argc * repeat));
+
+    start = bench_seconds();
+    for (int r = 0; r < repeat; r++) {
+        getopt_p_scan(argc, argv, bench_mask[0], bench_mask[1],
+            bench_mask[2], bench_mask[3]);
+    }
+    seconds = bench_seconds() - start;
+    options = 0;
+    for (int i = getopt_p_scan_next(bench_mask[0], 0, argc); i < argc;
+        i = getopt_p_scan_next(bench_mask[0], i + 1, argc)) {
+        options++;
+    }
+    printf("%-24s %9d %10ld %8.3f %10.2f ns/entry\n", "getopt_p_scan()",
+        argc, options, seconds, seconds * 1e9 / ((double)argc * repeat));
+    return;
+}
+
+/* Response file expanded in place, then parsed */
+void bench_rsp (void)
+{
+    /* Write a response file of quoted and unquoted arguments */
+    const char * path = "benchmark.rsp";
+    const char * line = "-9876543210 -Z \"quoted value\"\n";
+    FILE * fp = fopen(path, "w");
+    long written = 0;
+    if (fp == NULL) {
+        fprintf(stderr, "Error : can not write \"%s\"\n", path);
+        return;
+    }
+    while (written < BENCH_RSP_BYTES) {
+        written += (long)fwrite(line, 1, strlen(line), fp);
+    }
+    (void)fclose(fp);
+
+    char * argv[] = { "benchmark", "@benchmark.rsp", NULL };
+    getopt_p_rsp_map maps[1];
+    getopt_p_rsp rsp = { maps, 1, 0, 1 };
+    double start = bench_seconds();
+    int argc = getopt_p_rsp_expand(&rsp, 2, argv, bench_rsp_argv,
+        BENCH_RSP_ARGC);
+    double expand = bench_seconds() - start;
+
+    getopt_p_state state = GETOPT_P_STATE_INIT;
+    long options = 0;
+    int len;
+    state.opterr = 0;
+    while (getopt_p_parse_all(&state, argc, bench_rsp_argv, &bench_table,
+        bench_results, BENCH_RESULTS, &len) == -1) {
+        options += len;
+    }
+    options += len;
+    double total = bench_seconds() - start;
+
+    printf("\n%-24s %9d %10ld %8.3f %7.1f MB/s\n", "getopt_p_rsp_expand()",
+        argc, written, expand, (double)written / expand / 1e6);
+    printf("%-24s %9d %10ld %8.3f %7.1f MB/s\n", "  + getopt_p_parse_all()",
+        argc, options, total, (double)written / total / 1e6);
+    getopt_p_rsp_release(&rsp);
+    (void)remove(path);
+    return;
+}
+
+/* Long options, looked up in tables of 10, 100 and 1000 long options */
+void bench_long (void)
+{
+    int argc = BENCH_LONG_ENTRIES + 1;
+    printf("\n%-30s %9s %10s %8s %10s\n", "parser", "longopts", "options",
+        "seconds", "ns/option");
+
+    for (int count = 10, size = 0; count <= BENCH_LONG_MAX;
+        count *= 10, size++) {
+        /* Each size has its own array, so no index is ever stale */
+        getopt_p_option * longopts = bench_longopts[size];
+        /* Names sharing a long prefix, as in tools with many options */
+        for (int i = 0; i < count; i++) {
+            (void)snprintf(bench_long_names[i], sizeof(bench_long_names[i]),
+                "--long-option-%d-name", i);
+            (void)snprintf(bench_long_abbrevs[i],
+                sizeof(bench_long_abbrevs[i]), "--long-option-%d-", i);
+            getopt_p_option option = { &bench_long_names[i][2], 0, NULL, i };
+            longopts[i] = option;
+#ifndef _WIN32
+            struct option platform = { &bench_long_names[i][2], 0, NULL, i };
+            bench_platform_longopts[i] = platform;
+#endif /* #ifndef _WIN32 */
+        }
+        getopt_p_option end = { NULL, 0, NULL, 0 };
+        longopts[count] = end;
+#ifndef _WIN32
+        struct option platform_end = { NULL, 0, NULL, 0 };
+        bench_platform_longopts[count] = platform_end;
+#endif /* #ifndef _WIN32 */
+        (void)getopt_p_long_compile(&bench_long_index, longopts);
+
+        bench_long_argv(argc, &bench_long_names[0][0], count);
+        bench_long_run(longopts, count, argc, "");
+        bench_long_argv(argc, &bench_long_abbrevs[0][0], count);
+        bench_long_run(longopts, count, argc, " abbrev");
+    }
+    return;
+}
+
+void bench_long_argv (int argc, char * names, int count)
+{
+    /* Long options picked at random from count names of 32 characters */
+    char ** argv = bench_rsp_argv;
+    unsigned seed = 1;
+    argv[0] = "benchmark";
+    for (int i = 1; i < argc; i++) {
+        seed = seed * 1103515245u + 12345u;
+        argv[i] = &names[32 * ((seed >> 16) % (unsigned)count)];
+    }
+    argv[argc] = NULL;
+    return;
+}
+
+void bench_long_run (const getopt_p_option * longopts, int count, int argc,
+    const char * abbrev)
+{
+    /* Every entry is option (argv[i] - names) / 32, so check each value */
+    char ** argv = bench_rsp_argv;
+    const char * names = (abbrev[0] != '\0') ? &bench_long_abbrevs[0][0] :
+        &bench_long_names[0][0];
+    long options = 0;
+    long wrong = 0;
+    int c;
+    double start = bench_seconds();
+    GETOPT_P_NAME(optind) = 0;
+    while ((c = GETOPT_P_NAME(getopt_long)(argc, argv, "", longopts,
+        NULL)) != -1) {
+        options++;
+        wrong += (c != (int)((argv[options] - names) / 32));
+    }
+    bench_long_print("getopt_long()", abbrev, count, options, wrong,
+        bench_seconds() - start);
+
+    /* The hash of a caller supplied index, then binary search instead */
+    int was_hashed = bench_long_index.hashed;
+    for (int hashed = was_hashed; hashed >= 0; hashed--) {
+        bench_long_index.hashed = hashed;
+        getopt_p_state state = GETOPT_P_STATE_INIT;
+        options = 0;
+        wrong = 0;
+        start = bench_seconds();
+        while ((c = getopt_long_r(&state, argc, argv, "", &bench_long_index,
+            NULL)) != -1) {
+            options++;
+            wrong += (c != (int)((argv[options] - names) / 32));
+        }
+        bench_long_print(hashed ? "getopt_long_r()" :
+            "getopt_long_r() sorted", abbrev, count, options, wrong,
+            bench_seconds() - start);
+    }
+    bench_long_index.hashed = was_hashed;
+
+#ifndef _WIN32
+    options = 0;
+    wrong = 0;
+    start = bench_seconds();
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "+", bench_platform_longopts,
+        NULL)) != -1) {
+        options++;
+        wrong += (c != (int)((argv[options] - names) / 32));
+    }
+    bench_long_print("platform getopt_long()", abbrev, count, options, wrong,
+        bench_seconds() - start);
+#endif /* #ifndef _WIN32 */
+    return;
+}
+
+void bench_long_print (const char * parser, const char * abbrev, int count,
+    long options, long wrong, double seconds)
+{
+    char name[32];
+    (void)snprintf(name, sizeof(name), "%s%s", parser, abbrev);
+    printf("%-30s %9d %10ld %8.3f %10.2f%s\n", name, count, options, seconds,
+        seconds * 1e9 / (double)options, (wrong != 0) ? "  (wrong)" : "");
+    return;
+}
+
+/* Permuting argv of alternating operands and options */
+void bench_permute (void)
+{
+    char ** argv = bench_rsp_argv;
+    printf("\n%-24s %9s %10s %8s %10s\n", "parser", "argc", "options",
+        "seconds", "ns/entry");
+
+    for (int argc = 1001; argc <= BENCH_ARGC_MAX + 1; argc = argc * 10 - 9) {
+        long repeat = BENCH_PERMUTE_ENTRIES / argc;
+        repeat = (repeat > 0) ? repeat : 1;
+        long options = 0;
+        double seconds = 0.0;
+        for (long r = 0; r < repeat; r++) {
+            /* argv is rewritten, so is set up again (untimed) each time */
+            bench_permute_argv(argc);
+            double start = bench_seconds();
+            getopt_p_state state = GETOPT_P_STATE_INIT;
+            state.operands = bench_operands;
+            state.operands_max = argc;
+            while (getopt_r(&state, argc, argv, "v") != -1) {
+                options++;
+            }
+            seconds += bench_seconds() - start;
+        }
+        printf("%-24s %9d %10ld %8.3f %10.2f\n", "getopt_r() permute", argc,
+            options, seconds, seconds * 1e9 / ((double)argc * repeat));
+
+#ifndef _WIN32
+        /* The platform getopt_long() of GNU permutes by default */
+        if (argc - 1 > BENCH_PERMUTE_PLATFORM) {
+            continue;
+        }
+        options = 0;
+        seconds = 0.0;
+        for (long r = 0; r < repeat; r++) {
+            bench_permute_argv(argc);
+            double start = bench_seconds();
+            optind = 0;     /* Not 1, to reinitialise after "+" */
+            while (getopt_long(argc, argv, "v", NULL, NULL) != -1) {
+                options++;
+            }
+            seconds += bench_seconds() - start;
+        }
+        printf("%-24s %9d %10ld %8.3f %10.2f\n", "platform getopt_long()",
+            argc, options, seconds, seconds * 1e9 / ((double)argc * repeat));
+#endif /* #ifndef _WIN32 */
+    }
+    return;
+}
+
+void bench_permute_argv (int argc)
+{
+    /* Operands alternating with options, the worst case for exchanging */
+    char ** argv = bench_rsp_argv;
+    argv[0] = "benchmark";
+    for (int i = 1; i < argc; i++) {
+        argv[i] = (i % 2) ? "file" : "-v";
+    }
+    argv[argc] = NULL;
+    return;
+}
+
+/* Many short command lines parsed one after another, as by a daemon */
+void bench_reset (void)
+{
+    /* Stop part way through an option cluster, as an aborted parse might */
+    char * argv[] = { "task", "-vq", "-f", "file", "-abc", "operand", NULL };
+    int argc = 6;
+    const char * opt_str = "vqf:abc";
+    printf("\n%-24s %9s %10s %8s %10s\n", "parser", "argc", "lines",
+        "seconds", "ns/line");
+
+    long options = 0;
+    double start = bench_seconds();
+    for (long r = 0; r < BENCH_RESETS; r++) {
+        GETOPT_P_NAME(optind) = 0;
+        (void)GETOPT_P_NAME(getopt)(argc, argv, opt_str);
+        GETOPT_P_NAME(optind) = 0;
+        while (GETOPT_P_NAME(getopt)(argc, argv, opt_str) != -1) {
+            options++;
+        }
+    }
+    bench_reset_print("getopt() optind = 0", argc, options,
+        bench_seconds() - start);
+
+    options = 0;
+    start = bench_seconds();
+    for (long r = 0; r < BENCH_RESETS; r++) {
+        GETOPT_P_NAME(optind) = 1;
+        GETOPT_P_NAME(optreset) = 1;
+        (void)GETOPT_P_NAME(getopt)(argc, argv, opt_str);
+        GETOPT_P_NAME(optind) = 1;
+        GETOPT_P_NAME(optreset) = 1;
+        while (GETOPT_P_NAME(getopt)(argc, argv, opt_str) != -1) {
+            options++;
+        }
+    }
+    bench_reset_print("getopt() optreset = 1", argc, options,
+        bench_seconds() - start);
+
+#ifndef _WIN32
+    /* GNU getopt() restarts on optind = 0 (with "+" not to permute) */
+    options = 0;
+    start = bench_seconds();
+    for (long r = 0; r < BENCH_RESETS; r++) {
+        optind = 0;
+        (void)getopt_long(argc, argv, "+vqf:abc", NULL, NULL);
+        optind = 0;
+        while (getopt_long(argc, argv, "+vqf:abc", NULL, NULL) != -1) {
+            options++;
+        }
+    }
+    bench_reset_print("platform optind = 0", argc, options,
+        bench_seconds() - start);
+#endif /* #ifndef _WIN32 */
+    return;
+}
+
+void bench_reset_print (const char * name, int argc, long options,
+    double seconds)
+{
+    /* Every command line has six options, if each reset worked */
+    printf("%-24s %9d %10ld %8.3f %10.2f%s\n", name, argc, BENCH_RESETS,
+        seconds, seconds * 1e9 / (double)BENCH_RESETS,
+        (options == 6 * BENCH_RESETS) ? "" : "  (wrong options)");
+    return;
+}
+
+/* A long "find -print0" style stream of paths with a few options */
+void bench_stream (void)
+{
+    /* Write the stream to a temporary file, a block of it at a time */
+    FILE * file = tmpfile();
+    if (file == NULL) {
+        return;
+    }
+    size_t block_len = 0;
+    for (long i = 0; block_len + 64 < sizeof(bench_stream_buf); i++) {
+        const char * arg = (i % 32 == 0) ? "-9876543210" :
+            (i % 32 == 1) ? "-Z" : (i % 32 == 2) ? "value" : NULL;
+        if (arg != NULL) {
+            block_len += (size_t)sprintf(&bench_stream_buf[block_len], "%s",
+                arg) + 1;
+        } else {
+            block_len += (size_t)sprintf(&bench_stream_buf[block_len],
+                "src/module_%03ld/file_%06ld.c", i % 1000, i) + 1;
+        }
+    }
+    long bytes = 0;
+    while (bytes < BENCH_STREAM_BYTES) {
+        bytes += (long)fwrite(bench_stream_buf, 1, block_len, file);
+    }
+    (void)fflush(file);
+#ifdef _WIN32
+    int fd = _fileno(file);
+#else /* #ifdef _WIN32 */
+    int fd = fileno(file);
+#endif /* #ifdef _WIN32 */
+
+    printf("\n%-24s %9s %10s %8s %10s\n", "parser", "buffer", "arguments",
+        "seconds", "GB/s");
+    for (long buf_size = 4096; buf_size <= BENCH_STREAM_BUF; buf_size *= 16) {
+#ifdef _WIN32
+        (void)_lseek(fd, 0, SEEK_SET);
+#else /* #ifdef _WIN32 */
+        (void)lseek(fd, 0, SEEK_SET);
+#endif /* #ifdef _WIN32 */
+        getopt_p_stream stream;
+        getopt_p_stream_init(&stream, fd, '\0', bench_stream_buf,
+            (size_t)buf_size, &bench_table, "benchmark");
+        stream.state.opterr = 0;
+        double start = bench_seconds();
+        while (getopt_p_stream_next(&stream) != -1) {
+        }
+        double seconds = bench_seconds() - start;
+        printf("%-24s %9ld %10lld %8.3f %10.2f%s\n",
+            "getopt_p_stream_next()", buf_size, stream.index + 1, seconds,
+            (double)bytes / seconds / 1e9, stream.error ? "  (error)" : "");
+    }
+    (void)fclose(file);
+    return;
+}
+
+/* Typed option arguments, against strtoll() / strtoull() and errno */
+void bench_convert (void)
+{
+    /* Short and long numbers, cycled through so no one string is cached */
+    static const char * const sets[3][4] = {
+        { "8", "443", "65536", "12" },
+        { "9223372036854775807", "1234567890123456789", "4611686018427387904",
+            "8070450532247928832" },
+        { "0x7fffffffffffffff", "0x1234567890abcdef", "0xdeadbeefcafebabe",
+            "0x0123456789ABCDEF" }
+    };
+    static const char * const names[3] = { "short", "long", "hex" };
+    printf("\n%-24s %9s %10s %8s %10s\n", "parser", "digits", "numbers",
+        "seconds", "ns/number");
+
+    for (int set = 0; set < 3; set++) {
+        int type = (set == 2) ? getopt_p_type_uint64 : getopt_p_type_int64;
+        unsigned long long sum = 0;     /* Checks both give the same values */
+        double start = bench_seconds();
+        for (long r = 0; r < BENCH_CONVERSIONS; r++) {
+            getopt_p_value value;
+            if (getopt_p_convert(type, sets[set][r & 3], &value) ==
+                getopt_p_convert_ok) {
+                sum += (type == getopt_p_type_int64) ?
+                    (unsigned long long)value.i64 : value.u64;
+            }
+        }
+        double seconds = bench_seconds() - start;
+        printf("%-24s %9s %10ld %8.3f %10.2f\n", "getopt_p_convert()",
+            names[set], BENCH_CONVERSIONS, seconds,
+            seconds * 1e9 / (double)BENCH_CONVERSIONS);
+
+        unsigned long long strtol_sum = 0;
+        start = bench_seconds();
+        for (long r = 0; r < BENCH_CONVERSIONS; r++) {
+            /* The checks every caller of strtol() should make */
+            const char * arg = sets[set][r & 3];
+            char * end;
+            errno = 0;
+            unsigned long long value = (type == getopt_p_type_int64) ?
+                (unsigned long long)strtoll(arg, &end, 0) :
+                strtoull(arg, &end, 0);
+            if (errno == 0 && end != arg && *end == '\0') {
+                strtol_sum += value;
+            }
+        }
+        seconds = bench_seconds() - start;
+        printf("%-24s %9s %10ld %8.3f %10.2f%s\n",
+            (type == getopt_p_type_int64) ? "strtoll()" : "strtoull()",
+            names[set], BENCH_CONVERSIONS, seconds,
+            seconds * 1e9 / (double)BENCH_CONVERSIONS,
+            (strtol_sum == sum) ? "" : "  (wrong values)");
+    }
+
+    /* Sizes with units, against sscanf() and comparing unit names */
+    static const char * const sizes[4] = { "512M", "4KiB", "1500000KB",
+        "16G" };
+    unsigned long long sum = 0;
+    double start = bench_seconds();
+    for (long r = 0; r < BENCH_CONVERSIONS; r++) {
+        getopt_p_value value;
+        if (getopt_p_convert(getopt_p_type_size, sizes[r & 3], &value) ==
+            getopt_p_convert_ok) {
+            sum += value.u64;
+        }
+    }
+    double seconds = bench_seconds() - start;
+    printf("%-24s %9s %10ld %8.3f %10.2f\n", "getopt_p_convert()", "size",
+        BENCH_CONVERSIONS, seconds,
+        seconds * 1e9 / (double)BENCH_CONVERSIONS);
+
+    unsigned long long sscanf_sum = 0;
+    start = bench_seconds();
+    for (long r = 0; r < BENCH_CONVERSIONS; r++) {
+        static const char * const units[4] = { "M", "KiB", "KB", "G" };
+        static const unsigned long long scales[4] = { 1ULL << 20, 1ULL << 10,
+            1000ULL, 1ULL << 30 };
+        unsigned long long number;
+        char unit[4];
+        if (sscanf(sizes[r & 3], "%llu%3s", &number, unit) == 2) {
+            for (int i = 0; i < 4; i++) {
+                if (strcmp(unit, units[i]) == 0) {
+                    sscanf_sum += number * scales[i];
+                    break;
+                }
+            }
+        }
+    }
+    seconds = bench_seconds() - start;
+    printf("%-24s %9s %10ld %8.3f %10.2f%s\n", "sscanf()", "size",
+        BENCH_CONVERSIONS, seconds,
+        seconds * 1e9 / (double)BENCH_CONVERSIONS,
+        (sscanf_sum == sum) ? "" : "  (wrong values)");
+    return;
+}
+
+#ifndef __STDC_NO_THREADS__
+static char * bench_thread_argv[] = { "task", "-vq", "-f", "file", "-abc",
+    "operand", NULL };
+static mtx_t bench_mutex;
+
+/* getopt() on many threads, with and without a mutex around each parse */
+void bench_threads (void)
+{
+    printf("\n%-24s %9s %10s %8s %10s\n", "parser", "threads", "lines",
+        "seconds", "ns/line");
+    (void)mtx_init(&bench_mutex, mtx_plain);
+    for (int threads = 1; threads <= BENCH_THREADS_MAX; threads *= 2) {
+        bench_threads_run("getopt() mutex", bench_thread_mutex, threads);
+#ifdef GETOPT_P_THREAD_LOCAL
+        bench_threads_run("getopt() thread local", bench_thread_local,
+            threads);
+#endif /* #ifdef GETOPT_P_THREAD_LOCAL */
+    }
+    mtx_destroy(&bench_mutex);
+    return;
+}
+
+void bench_threads_run (const char * name, thrd_start_t fn, int threads)
+{
+    /* The same total number of command lines, shared between threads */
+    thrd_t thread[BENCH_THREADS_MAX];
+    long lines = BENCH_THREAD_LINES / threads;
+    double start = bench_seconds();
+    for (int t = 0; t < threads; t++) {
+        (void)thrd_create(&thread[t], fn, &lines);
+    }
+    for (int t = 0; t < threads; t++) {
+        (void)thrd_join(thread[t], NULL);
+    }
+    double seconds = bench_seconds() - start;
+    printf("%-24s %9d %10ld %8.3f %10.2f\n", name, threads,
+        lines * threads, seconds, seconds * 1e9 / (double)(lines * threads));
+    return;
+}
+
+/* Status quo : the global variables are shared, so parses take turns */
+int bench_thread_mutex (void * arg)
+{
+    long lines = *(const long *)arg;
+    for (long r = 0; r < lines; r++) {
+        (void)mtx_lock(&bench_mutex);
+        GETOPT_P_NAME(optind) = 0;
+        while (GETOPT_P_NAME(getopt)(6, bench_thread_argv, "vqf:abc") != -1) {
+        }
+        (void)mtx_unlock(&bench_mutex);
+    }
+    return 0;
+}
+
+/* Batch of very uneven command lines, parsed by several threads */
+void bench_batch (void)
+{
+    /* Mostly short command lines, with every tenth fifty times longer */
+    int results = 0;
+    for (int j = 0; j < BENCH_JOBS; j++) {
+        int argc = (j % 10 == 0) ? 500 : 10;
+        bench_jobs[j].argc = argc;
+        bench_jobs[j].argv = bench_argv;
+        bench_jobs[j].results = &bench_job_results[results];
+        bench_jobs[j].results_max = 4 * argc;   /* Most options per entry */
+        results += 4 * argc;
+    }
+
+    printf("\n%-24s %9s %10s %8s %10s\n", "parser", "threads", "jobs",
+        "seconds", "ns/job");
+    for (int threads = 1; threads <= BENCH_THREADS_MAX; threads *= 2) {
+        thrd_t thread[BENCH_THREADS_MAX];
+        getopt_p_batch batch = { bench_jobs, BENCH_JOBS, &bench_table, 0 };
+        double start = bench_seconds();
+        for (int t = 0; t < threads; t++) {
+            (void)thrd_create(&thread[t], bench_batch_thread, &batch);
+        }
+        for (int t = 0; t < threads; t++) {
+            (void)thrd_join(thread[t], NULL);
+        }
+        double seconds = bench_seconds() - start;
+        printf("%-24s %9d %10d %8.3f %10.2f\n", "getopt_p_batch_parse()",
+            threads, BENCH_JOBS, seconds, seconds * 1e9 / BENCH_JOBS);
+    }
+    return;
+}
+
+int bench_batch_thread (void * arg)
+{
+    return getopt_p_batch_parse((getopt_p_batch *)arg);
+}
+
+#ifdef GETOPT_P_THREAD_LOCAL
+/* Unmodified getopt() calls, each thread with its own global variables */
+int bench_thread_local (void * arg)
+{
+    long lines = *(const long *)arg;
+    for (long r = 0; r < lines; r++) {
+        GETOPT_P_NAME(optind) = 0;
+        while (GETOPT_P_NAME(getopt)(6, bench_thread_argv, "vqf:abc") != -1) {
+        }
+    }
+    return 0;
+}
+#endif /* #ifdef GETOPT_P_THREAD_LOCAL */
+#endif /* #ifndef __STDC_NO_THREADS__ */
+
+#ifndef _WIN32
+/* Platform getopt(), told not to permute argv by a leading '+' */
+long bench_platform_getopt (int argc, long repeat)
+{
+    long options = 0;
+    opterr = 0;
+    for (long r = 0; r < repeat; r++) {
+        optind = 1;
+        while (getopt(argc, bench_argv, "+" ":abcdefghijklmnopqrstuvwxyz"
+            "ABCDEFGHIJKLMNOPQRSTUVWXY0123456789Z:") != -1) {
+            options++;
+        }
+    }
+    return options;
+}
+#endif /* #ifndef _WIN32 */
@@ -0,0 +1,163 @@
+/*
+benchmark.cpp
+Benchmark of the "getop_p.h" C++20 interfaces against the equivalent C loop.
+SPDX-License-Identifier: Unlicense OR 0BSD
+
+The getopt_p::options range should cost nothing over calling
+getopt_compiled_r() by hand, so both are timed on the same command lines,
+along with the getopt_p::generate() coroutine :
+
+    c++ -std=c++20 -O2 -o benchmark_cpp benchmark.cpp
+*/
+
+#define GETOPT_P_FORCE_PORTABLE
+#define GETOPT_P_IMPLEMENTATION
+#include "getopt_p.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#define BENCH_ARGC_MIN 10           /* Fewest synthetic argv entries */
+#define BENCH_ARGC_MAX 1000000      /* Most synthetic argv entries */
+#define BENCH_ENTRIES 10000000L     /* Total argv entries parsed per timing */
+
+typedef long (* bench_fn) (int argc, long repeat);
+
+/* Option string with the options used by the benchmark near the end */
+using bench_parser = getopt_p::parser<
+    ":abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXY0123456789Z:">;
+
+static char * bench_argv[BENCH_ARGC_MAX+2];
+static volatile long bench_sink;    /* Keeps option arguments in use */
+
+double bench_seconds (void);
+void bench_setup (void);
+void bench_run (const char * name, bench_fn fn, int argc);
+long bench_loop (int argc, long repeat);
+long bench_range (int argc, long repeat);
+long bench_generate (int argc, long repeat);
+
+
+int main (void)
+{
+    bench_setup();
+
+    std::printf("%-24s %9s %10s %8s %10s\n", "parser", "argc", "options",
+        "seconds", "ns/option");
+    for (int entries = BENCH_ARGC_MIN; entries <= BENCH_ARGC_MAX;
+        entries *= 10) {
+        int argc = entries + 1;     /* Program name plus synthetic entries */
+        bench_run("getopt_compiled_r()", bench_loop, argc);
+        bench_run("getopt_p::options", bench_range, argc);
+        bench_run("getopt_p::generate()", bench_generate, argc);
+    }
+
+    std::exit(EXIT_SUCCESS);
+}
+
+
+double bench_seconds (void)
+{
+    struct timespec ts;
+    (void)timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void bench_setup (void)
+{
+    /* Alternate option clusters with options taking a separate argument */
+    static char cluster[] = "-9876543210";
+    static char option[] = "-Z";
+    static char value[] = "value";
+    static char name[] = "benchmark";
+    bench_argv[0] = name;
+    for (int i = 1; i <= BENCH_ARGC_MAX; i++) {
+        switch (i % 3) {
+        case 1 :
+            bench_argv[i] = cluster;
+            break;
+        case 2 :
+            bench_argv[i] = option;
+            break;
+        default :
+            bench_argv[i] = value;
+        }
+    }
+    return;
+}
+
+void bench_run (const char * name, bench_fn fn, int argc)
+{
+    /* Parse the same total number of argv entries for every argc */
+    long repeat = BENCH_ENTRIES / (argc - 1);
+    char * saved = bench_argv[argc];
+    bench_argv[argc] = NULL;
+
+    double start = bench_seconds();
+    long options = fn(argc, repeat);
+    double seconds = bench_seconds() - start;
+
+    bench_argv[argc] = saved;
+    std::printf("%-24s %9d %10ld %8.3f %10.2f\n", name, argc, options,
+        seconds, (options > 0) ? (seconds * 1e9 / (double)options) : 0.0);
+    return;
+}
+
+/* Hand written loop reading the option, argument and index from the state */
+long bench_loop (int argc, long repeat)
+{
+    long options = 0;
+    long arg_len = 0;
+    for (long r = 0; r < repeat; r++) {
+        getopt_p_state state = GETOPT_P_STATE_INIT;
+        state.opterr = 0;
+        for (;;) {
+            int index = state.optind;
+            int c = bench_parser::next(state, argc, bench_argv);
+            if (c == -1) {
+                break;
+            }
+            if (state.optarg != NULL) {
+                arg_len += (long)std::string_view(state.optarg).size();
+            }
+            options += (index > 0);
+        }
+    }
+    bench_sink = arg_len;
+    return options;
+}
+
+/* The same loop written as a range based for */
+long bench_range (int argc, long repeat)
+{
+    long options = 0;
+    long arg_len = 0;
+    for (long r = 0; r < repeat; r++) {
+        for (auto opt : bench_parser::parse(argc, bench_argv, false)) {
+            arg_len += (long)opt.arg.size();
+            options += (opt.index > 0);
+        }
+    }
+    bench_sink = arg_len;
+    return options;
+}
+
+/* The same loop resuming a coroutine for each option */
+long bench_generate (int argc, long repeat)
+{
+    long options = 0;
+    long arg_len = 0;
+    getopt_p::frame_buffer frame;
+    for (long r = 0; r < repeat; r++) {
+        getopt_p_state state = GETOPT_P_STATE_INIT;
+        state.opterr = 0;
+        for (auto opt : getopt_p::generate(frame, state, argc, bench_argv,
+            bench_parser::table)) {
+            arg_len += (long)opt.arg.size();
+            options += (opt.index > 0);
+        }
+    }
+    bench_sink = arg_len;
+    return options;
+}
@@ -8,7 +8,8 @@ POSIX compliant getopt() as a single header file interface / implementation.
 
 This software is intended to provide a POSIX compliant getopt() to platforms
 that do not have it (Windows). On non-Windows platforms the header file
-just includes the <unistd.h> implementation supplied by the platform.
+just includes the <unistd.h> implementation supplied by the platform,
+unless the portable implementation is requested by GETOPT_P_FORCE_PORTABLE.
 
 
 License
@@ -39,6 +40,46 @@ before including the header file in order to define the actual
 implementation.
 
 
+Portable Implementation on Other Platforms
+------------------------------------------
+
+To build, test or profile the portable implementation on a platform which
+has its own getopt(), "#define GETOPT_P_FORCE_PORTABLE" before including
+the header file (in every translation unit). The platform <unistd.h> is
+still included, so the POSIX names of the portable implementation are
+prefixed with "getopt_p_" to avoid colliding with it :
+
+    getopt_p_getopt(), getopt_p_optarg, getopt_p_optind,
+    getopt_p_opterr, getopt_p_optopt, getopt_p_optreset, getopt_p_getopt_long(),
+    getopt_p_getopt_long_only(), struct getopt_p_option,
+    getopt_p_no_argument, getopt_p_required_argument,
+    getopt_p_optional_argument
+
+GETOPT_P_NAME(getopt), GETOPT_P_NAME(optind) etc. expand to whichever
+name is in use, for code built both ways. The "benchmark.c" program uses
+this to compare the portable implementation with the platform getopt() on
+argv vectors of 10 to 1,000,000 entries :
+
+    cc -O2 -o benchmark benchmark.c
+
+The "test.c" program checks the error reporting, such as the argv index
+passed to an error handler :
+
+    cc -o test test.c && ./test
+
+With glibc, "test_glibc.c" runs getopt(), getopt_long() and
+getopt_long_only() side by side with the glibc versions on random argv.
+It covers '::', a leading '-' or ':', and permuting, and checks that every
+result matches :
+
+    cc -o test_glibc test_glibc.c && ./test_glibc
+
+Error messages name the program by the basename of argv[0] off Windows,
+found again for each error as an argv[0] buffer may be reused. On Windows
+the program path from _get_pgmptr(), which never changes, is used instead
+and its basename is found once and kept.
+
+
 "option string" Variants
 ------------------------
 
@@ -46,17 +87,451 @@ This getopt() implementation supports POSIX compliant option strings :
 * Supports ':' following an option character to require an argument
 * Supports ':' as the first character to return ':' for missing argument
 * Does not support '-' as an option character (POSIX compliance)
-* Does not support '::' optional-arguments to options (POSIX compliance)
+* Supports '::' following an option character for an optional-argument,
+  as an extension : "-O2" has the argument "2", while "-O" has none and
+  never takes the next argv entry as its argument
 * Does not support '+' as first character (already POSIX behaviour)
-* Does not support '-' as first character (POSIX compliance)
+* Supports '-' as first character (before any ':') as an extension, see
+  "In Order Operands" below
 
 The getopt() function does not permute argv; as per POSIX behaviour it
-stops parsing argv at the first non-option argument.
+stops parsing argv at the first non-option argument (unless permuting is
+requested, see below).
 
 See the POSIX documentation of getopt() for more detailed usage notes :
 https://pubs.opengroup.org/onlinepubs/009696799/functions/getopt.html
 
 
+Compiled Option Strings
+-----------------------
+
+Each call to getopt() searches the option string for the option character.
+For long option strings and very long command lines the option string can
+instead be compiled once into a lookup table :
+
+    getopt_p_table table;
+    getopt_p_compile(&table, ":hva1f:");
+    while ((c = getopt_compiled(argc, argv, &table)) != -1) {
+        ...
+    }
+
+getopt_compiled() behaves exactly like getopt() with the same option string,
+and shares the same global variables, but classifies each option character
+with a single table lookup. The "benchmark.c" program compares the two.
+
+
+Re-entrant Parsing
+------------------
+
+getopt_r() and getopt_compiled_r() keep all of their parsing state in a
+caller supplied getopt_p_state instead of the global variables, so several
+argv vectors can be parsed at once (for example on different threads) :
+
+    getopt_p_state state = GETOPT_P_STATE_INIT;
+    while ((c = getopt_r(&state, argc, argv, ":hva1f:")) != -1) {
+        ... state.optarg, state.optopt ...
+    }
+    ... operands start at argv[state.optind] ...
+
+The state members optarg, optind, opterr and optopt have the same meaning
+as the global variables of the same name. The err_kind member tells which
+error (if any) was found, even when getopt_r() returns '?' for both.
+getopt() and getopt_compiled() are thin wrappers which parse with a single
+internal state and copy it to and from the global variables.
+
+
+Thread Local Global Variables
+-----------------------------
+
+Existing code calling getopt() on several threads at once can instead be
+made safe by building with "#define GETOPT_P_THREAD_LOCAL" (in every
+translation unit, before including the header file). optarg, optind,
+opterr, optopt, optreset and the internal state of getopt() are then
+thread local (C11 _Thread_local or C++11 thread_local), so each thread
+parses independently without any locking. This includes the settings of
+getopt_p_set_error_fn() and getopt_p_set_permute(), which apply to the
+calling thread only.
+
+
+Error Handlers
+--------------
+
+Instead of being printed, errors can be passed to an error handler along
+with a caller supplied context pointer :
+
+    void on_error (const getopt_p_error_info * info, void * context);
+
+    getopt_p_set_error_fn(on_error, &my_log);   // for getopt()
+    state.err_fn = on_error;                    // for getopt_r() etc.
+    state.err_context = &my_log;
+
+The getopt_p_error_info holds the kind of error (getopt_p_option_unknown,
+getopt_p_option_missing or getopt_p_option_invalid), the option character
+(or for getopt_long() the long_len characters of long_name, the long
+option in argv), the index of its argv entry and the program name;
+nothing is formatted. The handler
+is called exactly when the error would otherwise have been printed, so
+opterr == 0 or a leading ':' in the option string still suppress it.
+
+
+Parsing All Options at Once
+---------------------------
+
+getopt_p_parse_all() parses every option of argv in a single call, writing
+a getopt_p_result record per option in to a caller supplied array :
+
+    getopt_p_result results[64];
+    int len;
+    int first = getopt_p_parse_all(&state, argc, argv, &table, results, 64,
+        &len);
+
+Each record holds the option character, its argument, where it was found
+in argv and the kind of error found (if any). When permuting (see
+"Permuting argv" below) argv_idx is the index of the entry in argv as
+rewritten, not where it was before. The return value is the index
+in argv of the first operand. If the array fills up before all options are
+parsed then -1 is returned; calling again with the same state continues
+from where parsing stopped. No dynamic memory is used.
+
+getopt_p_validate() checks a whole argv without printing anything, writing
+a record for each error (the first diags_max of them) in to an array of the
+same getopt_p_result records and returning how many errors there are :
+
+    getopt_p_result diags[16];
+    int errors = getopt_p_validate(argc, argv, &table, diags, 16);
+
+getopt_p_batch_parse() parses a batch of many independent command lines
+against one compiled option string, each in to its own caller supplied
+records as per getopt_p_parse_all() (without printing errors). It may be
+called from any number of threads at once, each of which claims one job
+at a time until none are left, so threads stay busy however uneven the
+jobs are. It returns the number of jobs the calling thread parsed :
+
+    getopt_p_batch batch = { jobs, jobs_len, &table, 0 };
+    ... on each worker thread : getopt_p_batch_parse(&batch); ...
+
+getopt_p_scan() classifies a whole argv in bulk, setting one bit per entry
+in bitmasks of options, "-", "--" and operands (any of which may be NULL).
+Entries are classified eight at a time from their first bytes, without
+comparing strings. getopt_p_scan_next() then skips straight to the next
+entry of a kind, for example past a long run of operands :
+
+    unsigned long long operand[GETOPT_P_SCAN_WORDS(MAX_ARGC)];
+    getopt_p_scan(argc, argv, NULL, NULL, NULL, operand);
+    int first = getopt_p_scan_next(operand, 1, argc);
+
+
+Typed Option Arguments
+----------------------
+
+Options of a compiled table can be given a type with getopt_p_set_type(),
+so their arguments are converted as they are parsed instead of by strtol()
+and errno checks afterwards :
+
+    getopt_p_compile(&table, "j:p:s:c:");
+    getopt_p_set_type(&table, 'j', getopt_p_type_int32);
+    getopt_p_set_type(&table, 's', getopt_p_type_uint64);
+    getopt_p_set_type(&table, 'c', getopt_p_type_bool);
+    while ((c = getopt_compiled(argc, argv, &table)) != -1) {
+        if (c == 'j') {
+            threads = getopt_p_optvalue.i32;
+        } ...
+    }
+
+The value is in the getopt_p_optvalue member matching the type (i32, i64,
+u64 or boolean), or state.optvalue for getopt_compiled_r(). Numbers are
+decimal or "0x" hex, with a sign for the signed types; digits are
+converted eight at a time (SWAR) with exact overflow detection. Booleans
+are 1/0, true/false, yes/no or on/off in any case. An argument which
+does not convert is an error of kind getopt_p_option_invalid, printed
+(or passed to the error handler, with the argument in info.optarg) as
+for any other error, and '?' is returned. getopt_p_convert() converts a
+string the same way, returning a getopt_p_convert_error or zero.
+getopt_p_set_type() returns -1 for an option without an argument, so
+call it after getopt_p_compile(), which clears all the types.
+
+Sizes and durations are decimal numbers with an optional unit, converted
+to a u64 number of bytes or nanoseconds :
+
+    getopt_p_set_type(&table, 'm', getopt_p_type_size);      // -m 512M
+    getopt_p_set_type(&table, 't', getopt_p_type_duration);  // -t 1500ms
+
+Size units are B, K, M, G and T, which are powers of 1024 as for dd, the
+SI units KB, MB, GB and TB (powers of 1000), and the IEC units KiB, MiB,
+GiB and TiB; k and kB are accepted for K and KB. Duration units are ns,
+us, ms, s, m (minutes) and h, and a number without a unit is in seconds.
+An unknown unit ("invalid size unit for option") and a value which does
+not fit in 64 bits ("number out of range for option") are reported
+separately, and the printed message ends with the argument, as in
+"invalid size unit for option '-m' : '5XB'".
+
+
+C++ Compile Time Option Strings
+-------------------------------
+
+With C++20 the option string can be given as a template argument; it is
+checked and compiled in to its lookup table at compile time :
+
+    using opts = getopt_p::parser<":hva1f:">;
+    while ((c = opts::next(argc, argv)) != -1) {
+        ...
+    }
+
+An option string using ':' or '-' as an option character (other than a
+leading '-') fails to compile instead of returning '?' at runtime.
+opts::next(state, argc, argv) is the re-entrant equivalent.
+
+
+C++ Option Ranges
+-----------------
+
+With C++20 the options can also be iterated as a range, without reading
+any global variables. Each option has its option character (as returned
+by getopt()), argument, index in argv and getopt_p_error kind :
+
+    getopt_p::options opts(argc, argv, ":ab:");
+    for (auto opt : opts) {
+        if (opt.option == 'b' && opt.has_arg()) {
+            std::string_view file = opt.arg;
+        }
+    }
+    for (char * operand : opts.rest()) {
+        ...
+    }
+
+The range holds its own getopt_p_state, so nothing is allocated and the
+loop compiles to the same code as calling getopt_compiled_r() by hand
+(see benchmark.cpp). The option string may be replaced by a compiled
+table, or checked at compile time with parser<":ab:">::parse(argc, argv).
+Passing false after the option string turns off printing errors. rest()
+is the span of operands after the last option parsed.
+
+Where parsing has to be interleaved with other work, getopt_p::generate()
+is a coroutine which parses one option each time it is resumed, with the
+caller's getopt_p_state. Its frame is placed in a caller supplied
+getopt_p::frame_buffer (GETOPT_P_FRAME_MAX bytes, default 256) and never
+on the heap. If the frame does not fit the generator is empty and
+failed() is true. An exception thrown by an error handler ends the
+generator and is rethrown from next(). Between calls to next() the caller
+may do anything, including co_await in its own coroutine :
+
+    getopt_p::frame_buffer frame;
+    getopt_p_state state = GETOPT_P_STATE_INIT;
+    auto gen = getopt_p::generate(frame, state, argc, argv, table);
+    while (gen.next()) {
+        if (gen.value().option == 'f') {
+            co_await open_file(gen.value().arg);
+        }
+    }
+
+
+Response Files
+--------------
+
+getopt_p_rsp_expand() optionally expands "@file" arguments, replacing each
+with the arguments read from the named response file, before parsing :
+
+    getopt_p_rsp_map maps[16];
+    getopt_p_rsp rsp = { maps, 16, 0, 8 };  // maps, maps_max, 0, depth_max
+    char * rsp_argv[4096];
+    int rsp_argc = getopt_p_rsp_expand(&rsp, argc, argv, rsp_argv, 4096);
+    ... parse rsp_argc / rsp_argv as usual ...
+    getopt_p_rsp_release(&rsp);
+
+Each response file is memory mapped copy-on-write and split in place, so
+the arguments (and any optarg) point straight in to the mapping and are
+valid until getopt_p_rsp_release(). Arguments are separated by whitespace;
+'...' and "..." quote whitespace and '\' escapes a quote, '\' or
+whitespace. Response files may name further response files, nested up to
+depth_max deep, with one entry of maps used per non-empty file.
+
+The new argc is returned, or -1 if a file can not be read, rsp_argv or
+maps is too small, or the nesting is too deep. Call getopt_p_rsp_release()
+in either case.
+
+
+Options From the Environment
+----------------------------
+
+getopt_p_env_expand() puts default options from an environment variable
+(as for GZIP or LESS) ahead of the real arguments, in to a new argv
+parsed as usual with the same option string :
+
+    char env_buf[1024];
+    char * env_argv[4096];
+    int env_argc = getopt_p_env_expand(getenv("MYTOOL_OPTS"), env_buf,
+        sizeof(env_buf), argc, argv, env_argv, 4096);
+
+The value (which may be NULL) is copied once in to buf and split in
+place, with the same quoting as response files. Options given in argv
+come later, so they override the defaults where the program keeps the
+last value. The first (env_argc - argc) arguments after the program name
+are from the variable, so optind - (env_argc - argc) is the matching
+index in argv once parsing has passed them. Like an option given in argv,
+an operand or "--" in the variable ends the options. The new argc is
+returned, or -1 if buf or env_argv is too small.
+
+
+Layered Option Sources
+----------------------
+
+getopt_p_merge() resolves settings given in several layers, such as
+built-in defaults, config files, an environment variable and argv, in a
+single pass. Each layer is an argv-like vector whose argv[0] names it in
+error messages (getopt_p_env_expand() with argc = 1 splits a config
+buffer in to one). Layers are given lowest precedence first :
+
+    getopt_p_layer layers[] = {
+        { defaults_argc, defaults_argv, 0 },
+        { env_argc, env_argv, 0 },
+        { argc, argv, 0 }
+    };
+    getopt_p_setting settings[256];
+    int errors = getopt_p_merge(layers, 3, &table, "v", 1, settings);
+    if (settings['f'].layer >= 0) {
+        file = settings['f'].value;
+    }
+
+settings[] is indexed by option character, with the argument of the
+winning occurrence (or NULL), the index of its layer (-1 if the option
+was never given) and a count. An option listed in accumulate (here "v")
+is counted across all layers, so "-vv" in the defaults and "-v" in argv
+count three; any other option given in a layer overrides the earlier
+layers and counts only its occurrences in that layer. Errors are printed
+as per getopt() (if print_errors is non-zero) and counted in the return
+value. Each layer's first_operand is set to the index of its first
+operand.
+
+
+Streaming Arguments
+-------------------
+
+getopt_p_stream_next() parses arguments read from a file descriptor, such
+as the output of "find -print0", without building an argv. Arguments are
+delimited by '\0' or '\n' and read through a caller supplied buffer, so
+memory use does not depend on the length of the stream :
+
+    char buf[65536];
+    getopt_p_stream stream;
+    getopt_p_stream_init(&stream, 0, '\0', buf, sizeof(buf), &table,
+        argv[0]);
+    while ((c = getopt_p_stream_next(&stream)) != -1) {
+        ... 1 for an operand, otherwise as per getopt_r() ...
+    }
+    if (stream.error) ...
+
+Options and operands are returned in the order they are read, as for an
+option string starting with '-'; after "--" everything is an operand.
+stream.state.optarg is the operand or option argument, '\0' terminated in
+place in buf and valid until the next call, and stream.index is its index
+in the stream. Options are parsed (and errors reported) as per
+getopt_compiled_r() with stream.state, except that an error handler is
+given the index in the stream of the entry with the option as argv_idx.
+An argument straddling the end of buf is moved down to the start, so buf
+must be longer than the longest argument, or option and separate option
+argument together. A longer argument or a read error ends the stream with
+stream.error set.
+
+
+Long Options
+------------
+
+getopt_long() and getopt_long_only() accept GNU style long options as well
+as the short options of the option string, sharing the same global
+variables and error reporting as getopt() :
+
+    static const struct option longopts[] = {
+        { "verbose", no_argument, NULL, 'v' },
+        { "file", required_argument, NULL, 'f' },
+        { "color", optional_argument, &color_flag, 1 },
+        { NULL, 0, NULL, 0 }
+    };
+    while ((c = getopt_long(argc, argv, ":vf:", longopts, NULL)) != -1) {
+        ...
+    }
+
+Long options are "--name", "--name=arg" or "--name arg" (required_argument
+only), and may be abbreviated to any unique prefix of the name. With
+getopt_long_only() "-name" is also a long option, unless it does not match
+one and its first character is a short option. As with getopt(), argv is
+only permuted on request.
+
+Names are found with a perfect hash, so one lookup costs the same for ten
+or a thousand long options. getopt_long() builds the hash at the start of
+each parse (optind 0 or 1, or optreset), so an array refilled with new
+options between parses is indexed again, as is a different table or one
+whose number of entries changes. For getopt_long_r() and
+getopt_long_only_r() the hash is built once in to a caller supplied
+getopt_p_long_index :
+
+    getopt_p_long_index index;      // Large, make it static
+    getopt_p_long_compile(&index, longopts);
+    while ((c = getopt_long_r(&state, argc, argv, ":vf:", &index, NULL))
+        != -1) {
+        ...
+    }
+
+Abbreviations are found by binary search of the names, which are sorted
+when the hash is built. An ambiguous abbreviation is reported along with
+the long options it could be, which an error handler gets as candidates
+(candidates_len indices in to longopts). Tables of more than
+GETOPT_P_LONG_MAX (default 1024) long options are searched linearly.
+
+
+In Order Operands
+-----------------
+
+As per GNU getopt(), an option string starting with '-' asks for operands
+to be returned in order along with the options, each as the optarg of an
+option character of 1, instead of stopping at the first operand :
+
+    while ((c = getopt(argc, argv, "-:vf:")) != -1) {
+        switch (c) {
+        case 1 :        // Operand, may be processed at once
+            process_file(optarg);
+            break;
+        ...
+
+argv is never rewritten, so work on each operand can start while the rest
+of argv is still to be parsed. "--" still ends the options; any entries
+after it are left for the caller from optind. This is an extension, and
+is not POSIX behaviour.
+
+
+Permuting argv
+--------------
+
+GNU getopt() permutes argv, so that "tool file1 -v file2" still sees -v,
+and programs ported from it may rely on this. Permuting is requested by
+supplying an array with room for the operands, which are set aside there
+while the options after them are parsed :
+
+    char * operands[MAX_ARGC];
+    getopt_p_set_permute(operands, MAX_ARGC);       // for getopt()
+    state.operands = operands;                      // for getopt_r() etc.
+    state.operands_max = MAX_ARGC;
+
+When -1 is returned argv has been rewritten (as per GNU, despite being
+const) with the options first, in order, followed by the operands, in
+order, starting at optind. Everything after "--" is an operand, left in
+place after the operands set aside. Each entry is moved at most twice, so
+unlike the exchange() of GNU getopt() the time taken is linear in argc.
+If operands_max is less than the number of operands, parsing stops early
+with the options parsed so far followed by all remaining entries.
+
+
+Parsing Again
+-------------
+
+To parse another argv, or the same one again, from the start (as a long
+running program handling many command lines might), either set optind to
+0 as per GNU getopt(), or set optreset to 1 and optind to 1 as per BSD
+getopt(). Both restart cleanly even if the last parse stopped part way
+through a cluster of options such as "-abc". Setting optind to any other
+value also restarts at the new optind. For getopt_r() and the other
+re-entrant functions, set state.optind to 0.
+
+
 Use Case
 --------
 
@@ -68,8 +543,8 @@ The other use case is a pragmatic programmer who needs a simple lightweight
 argument parser, does not need complicated options, prefers standards
 compliance / portability and would prefer an unencumbered implementation.
 
-If you require complicated argument parsing with long verbose options,
-this is not the library for you. See below for some alternatives.
+If you require complicated argument parsing beyond getopt_long(), this
+is not the library for you. See below for some alternatives.
 
 
 Implentation Notes
@@ -79,8 +554,11 @@ Implentation Notes
   implementation of the library
 * The library pollutes the global namespace
 * You interact with getopt() via global variables
-* The getopt() function is not re-entrant
+* The getopt() function is not re-entrant, getopt_r() is re-entrant;
+  GETOPT_P_THREAD_LOCAL makes getopt() safe to call from several threads
 * The library does not use any dynamic memory
+* Error messages are formatted on the stack and written with one write(),
+  unless an error handler is set
 * Any returned strings are pointers into the existing argv string
 * The code compiles cleanly at high warning levels
 
@@ -96,7 +574,8 @@ https://pubs.opengroup.org/onlinepubs/009696799/functions/getopt.html
 Namespace pollution is small and controlled so typically is not a problem.
 
 Argument processing is typically performed once at program initialisation,
-so the lack of re-entrancy is not an issue for common use cases.
+so the lack of re-entrancy is not an issue for common use cases. Programs
+which do need it can use getopt_r() without giving up getopt().
 
 
 History
@@ -136,26 +615,759 @@ Alternative Argument Parsers
 
 #ifndef _WIN32
 #include <unistd.h>	        /* Not Windows - use platform implementation */
-#else /* #ifndef _WIN32 */
+#endif /* #ifndef _WIN32 */
+
+/* Portable implementation on Windows, or on request on other platforms */
+#if defined(_WIN32) || defined(GETOPT_P_FORCE_PORTABLE)
+
+/* POSIX names, prefixed with "getopt_p_" alongside a platform <unistd.h> */
+#ifdef _WIN32
+#define GETOPT_P_NAME(name) name
+#else /* #ifdef _WIN32 */
+#define GETOPT_P_NAME(name) getopt_p_##name
+#endif /* #ifdef _WIN32 */
+
+/* Storage of the global variables, thread local on request */
+#if !defined(GETOPT_P_THREAD_LOCAL)
+#define GETOPT_P_TLS
+#elif defined(__cplusplus)
+#define GETOPT_P_TLS thread_local
+#elif defined(_MSC_VER)
+#define GETOPT_P_TLS __declspec(thread)
+#else
+#define GETOPT_P_TLS _Thread_local
+#endif /* #if !defined(GETOPT_P_THREAD_LOCAL) */
+
+#include <stddef.h>             /* size_t */
+#include <stdint.h>             /* int32_t, int64_t, uint64_t */
 
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
 
-extern const char * optarg; /* Pointer in to argv to return option argument */
-extern int optind;          /* Index in argv of next element to be processed */
-extern int opterr;          /* Flag to indicate if getopt() prints errors */
-extern int optopt;          /* Variable to return erroneous option character */
-
-int getopt (int argc, char * const argv[], const char * opt_str);
+/* Pointer in to argv to return option argument */
+extern GETOPT_P_TLS const char * GETOPT_P_NAME(optarg);
+/* Index in argv of next element to be processed */
+extern GETOPT_P_TLS int GETOPT_P_NAME(optind);
+/* Flag to indicate if getopt() prints errors */
+extern GETOPT_P_TLS int GETOPT_P_NAME(opterr);
+/* Variable to return erroneous option character */
+extern GETOPT_P_TLS int GETOPT_P_NAME(optopt);
+/* Flag to restart parsing from optind, as per BSD getopt() */
+extern GETOPT_P_TLS int GETOPT_P_NAME(optreset);
+
+int GETOPT_P_NAME(getopt) (int argc, char * const argv[],
+    const char * opt_str);
+
+
+/* Classification of a character in a compiled option string */
+enum getopt_p_class {
+    getopt_p_class_unknown = 0, /* Not an option character */
+    getopt_p_class_flag = 1,    /* Option character without an argument */
+    getopt_p_class_arg = 2,     /* Option character requiring an argument */
+    getopt_p_class_optional = 3 /* Option character with attached argument */
+};
+
+/* Type an option argument is converted to, as set by getopt_p_set_type() */
+enum getopt_p_type {
+    getopt_p_type_none = 0,     /* No conversion, only optarg */
+    getopt_p_type_int32 = 1,    /* Decimal or "0x" hex, with optional sign */
+    getopt_p_type_int64 = 2,    /* Decimal or "0x" hex, with optional sign */
+    getopt_p_type_uint64 = 3,   /* Decimal or "0x" hex, with optional '+' */
+    getopt_p_type_bool = 4,     /* 1/0, true/false, yes/no or on/off */
+    getopt_p_type_size = 5,     /* Bytes, decimal with a K/M/G/T unit */
+    getopt_p_type_duration = 6  /* Nanoseconds, decimal with a ns..h unit */
+};
+
+/* Result of getopt_p_convert(), other than getopt_p_convert_ok */
+enum getopt_p_convert_error {
+    getopt_p_convert_ok = 0,        /* Converted */
+    getopt_p_convert_syntax = 1,    /* Not a number or boolean at all */
+    getopt_p_convert_range = 2,     /* Number out of range of the type */
+    getopt_p_convert_unit = 3       /* Size or duration unit not known */
+};
+
+/* Converted option argument, the member matching the getopt_p_type */
+typedef union getopt_p_value {
+    int32_t i32;            /* getopt_p_type_int32 */
+    int64_t i64;            /* getopt_p_type_int64 */
+    uint64_t u64;           /* getopt_p_type_uint64, size or duration */
+    int boolean;            /* getopt_p_type_bool, 0 or 1 */
+} getopt_p_value;
+
+/* Converted value of optarg, when getopt_compiled() returns a typed option */
+extern GETOPT_P_TLS getopt_p_value getopt_p_optvalue;
+
+/* Option string compiled into a lookup table by getopt_p_compile() */
+typedef struct getopt_p_table {
+    unsigned char option_class[256];    /* getopt_p_class of each character */
+    int missing_colon;  /* Flag for ':' as first character of option string */
+    int in_order;       /* Flag for '-' as first character of option string */
+    unsigned char option_type[256];     /* getopt_p_type of each character */
+} getopt_p_table;
+
+int getopt_p_compile (getopt_p_table * table, const char * opt_str);
+int getopt_p_set_type (getopt_p_table * table, int option, int type);
+int getopt_p_convert (int type, const char * arg, getopt_p_value * value);
+int getopt_compiled (int argc, char * const argv[],
+    const getopt_p_table * table);
+
+
+/* Kind of error found for an option; also the value getopt() returns */
+enum getopt_p_error {
+    getopt_p_option_valid = 0,              /* No error */
+    getopt_p_option_unknown = (int)'?',     /* Option character not known */
+    getopt_p_option_missing = (int)':',     /* Option argument is missing */
+    getopt_p_option_invalid = (int)'#'      /* Option argument not its type */
+};
+
+/* Values of has_arg in a long option, as per GNU <getopt.h> */
+enum {
+    GETOPT_P_NAME(no_argument) = 0,         /* "--name" only */
+    GETOPT_P_NAME(required_argument) = 1,   /* "--name=arg" or "--name arg" */
+    GETOPT_P_NAME(optional_argument) = 2    /* "--name" or "--name=arg" */
+};
+
+/* Long option, as per GNU getopt_long(), ended by an entry with no name */
+struct GETOPT_P_NAME(option) {
+    const char * name;      /* Name of the long option, without the "--" */
+    int has_arg;            /* no_argument, required_ or optional_argument */
+    int * flag;             /* If not NULL set *flag to val and return 0 */
+    int val;                /* Value to return, or to set *flag to */
+};
+typedef struct GETOPT_P_NAME(option) getopt_p_option;
+
+/* Error passed to an error handler, in place of printing it */
+typedef struct getopt_p_error_info {
+    int err_kind;           /* getopt_p_error kind of the error */
+    int option;             /* Option character in error */
+    int argv_idx;           /* Index in argv of the entry with the option */
+    const char * prog_name; /* Program name, as used when printing errors */
+    const char * long_name; /* Long option ("--name") in error, or NULL */
+    int long_len;           /* Number of characters of long_name in error */
+    const getopt_p_option * longopts;   /* Long options of the candidates */
+    const unsigned short * candidates;  /* Index in longopts of each match */
+    int candidates_len;     /* Number of matches of an ambiguous option */
+    const char * optarg;    /* Option argument which failed to convert */
+} getopt_p_error_info;
+
+/* Error handler, called for each error that would have been printed */
+typedef void (* getopt_p_error_fn) (const getopt_p_error_info * info,
+    void * context);
+
+/* Parser state for the re-entrant getopt_r() and getopt_compiled_r() */
+typedef struct getopt_p_state {
+    const char * optarg;    /* Pointer in to argv to return option argument */
+    int optind;             /* Index in argv of next element to be processed */
+    int opterr;             /* Flag to indicate if getopt_r() prints errors */
+    int optopt;             /* Variable to return erroneous option character */
+    int err_kind;           /* getopt_p_error kind of the last option */
+    getopt_p_error_fn err_fn;   /* Error handler, or NULL to print errors */
+    void * err_context;     /* Context pointer passed to err_fn */
+    char ** operands;       /* Operands set aside when permuting, or NULL */
+    int operands_max;       /* Number of entries in operands */
+    int operands_len;       /* Internal : number of operands set aside */
+    int arg_idx;            /* Internal : character index into argv entry */
+    getopt_p_value optvalue;    /* Converted optarg of a typed option */
+} getopt_p_state;
+
+/* Static initialiser for a getopt_p_state, as per getopt_p_state_init() */
+#define GETOPT_P_STATE_INIT { 0, 1, 1, (int)'?', 0, 0, 0, 0, 0, 0, 0, { 0 } }
+
+void getopt_p_state_init (getopt_p_state * state);
+void getopt_p_set_error_fn (getopt_p_error_fn err_fn, void * err_context);
+void getopt_p_set_permute (char * operands[], int operands_max);
+int getopt_r (getopt_p_state * state, int argc, char * const argv[],
+    const char * opt_str);
+int getopt_compiled_r (getopt_p_state * state, int argc, char * const argv[],
+    const getopt_p_table * table);
+
+
+/* Record of one parsed option, as written by getopt_p_parse_all() */
+typedef struct getopt_p_result {
+    const char * optarg;    /* Pointer in to argv to option argument, or NULL */
+    int argv_idx;           /* Index in argv of the entry with the option */
+    int char_idx;           /* Index of the option character in that entry */
+    char option;            /* Option character, as per optopt */
+    char err_kind;          /* getopt_p_error kind, zero for a valid option */
+} getopt_p_result;
+
+int getopt_p_parse_all (getopt_p_state * state, int argc, char * const argv[],
+    const getopt_p_table * table, getopt_p_result * results, int results_max,
+    int * results_len);
+int getopt_p_validate (int argc, char * const argv[],
+    const getopt_p_table * table, getopt_p_result * diags, int diags_max);
+
+
+/* One command line of a batch, as parsed by getopt_p_batch_parse() */
+typedef struct getopt_p_job {
+    int argc;               /* Number of entries in argv */
+    char * const * argv;    /* Command line to parse */
+    getopt_p_result * results;  /* Caller supplied records for this job */
+    int results_max;        /* Number of entries in results */
+    int results_len;        /* Number of records written to results */
+    int first_operand;      /* As returned by getopt_p_parse_all() */
+} getopt_p_job;
+
+/* Batch of command lines parsed against one compiled option string */
+typedef struct getopt_p_batch {
+    getopt_p_job * jobs;    /* Caller supplied array of jobs */
+    int jobs_len;           /* Number of entries in jobs */
+    const getopt_p_table * table;   /* Compiled option string for all jobs */
+    volatile long next_job; /* Internal : next job to parse, initially 0 */
+} getopt_p_batch;
+
+int getopt_p_batch_parse (getopt_p_batch * batch);
+
+
+/* One source of arguments for getopt_p_merge(), such as a config file */
+typedef struct getopt_p_layer {
+    int argc;               /* Number of entries in argv */
+    char * const * argv;    /* Arguments, argv[0] naming the source */
+    int first_operand;      /* Set to the index in argv of the first operand */
+} getopt_p_layer;
+
+/* Effective value of one option character after getopt_p_merge() */
+typedef struct getopt_p_setting {
+    const char * value;     /* Option argument of the winning occurrence */
+    int layer;              /* Index of its layer, or -1 if never given */
+    int count;              /* Number of occurrences counted */
+} getopt_p_setting;
+
+int getopt_p_merge (getopt_p_layer * layers, int layers_len,
+    const getopt_p_table * table, const char * accumulate,
+    int print_errors, getopt_p_setting settings[256]);
+
+
+/* Words needed for a getopt_p_scan() bitmask with a bit per argv entry */
+#define GETOPT_P_SCAN_WORDS(argc) (((argc) + 63) / 64)
+
+void getopt_p_scan (int argc, char * const argv[], unsigned long long option[],
+    unsigned long long dash[], unsigned long long dashdash[],
+    unsigned long long operand[]);
+int getopt_p_scan_next (const unsigned long long mask[], int from, int argc);
+
+
+/* Memory mapping of one response file, see getopt_p_rsp_expand() */
+typedef struct getopt_p_rsp_map {
+    void * base;            /* Start of the private (copy-on-write) mapping */
+    size_t size;            /* Size of the mapping in bytes */
+} getopt_p_rsp_map;
+
+/* Response file ("@file") expansion context */
+typedef struct getopt_p_rsp {
+    getopt_p_rsp_map * maps;    /* Caller supplied array of mappings */
+    int maps_max;               /* Number of entries in maps */
+    int maps_len;               /* Number of entries of maps in use */
+    int depth_max;              /* Deepest nesting of response files */
+} getopt_p_rsp;
+
+int getopt_p_rsp_expand (getopt_p_rsp * rsp, int argc, char * const argv[],
+    char * rsp_argv[], int rsp_argv_max);
+void getopt_p_rsp_release (getopt_p_rsp * rsp);
+int getopt_p_env_expand (const char * value, char * buf, size_t buf_size,
+    int argc, char * const argv[], char * env_argv[], int env_argv_max);
+
+
+/* Arguments read from a file descriptor through a caller supplied buffer */
+typedef struct getopt_p_stream {
+    getopt_p_state state;   /* Parsing state, optarg is in to buf */
+    const getopt_p_table * table;   /* Compiled option string */
+    const char * prog_name; /* Program name for error messages */
+    int fd;                 /* File descriptor to read arguments from */
+    int delim;              /* Argument delimiter, '\0' or '\n' */
+    char * buf;             /* Caller supplied buffer */
+    size_t buf_size;        /* Size of buf, the longest argument plus one */
+    long long index;        /* Index in the stream of the last argument */
+    int error;              /* Non-zero after a read error or long argument */
+    size_t head;            /* Internal : offset of the current argument */
+    size_t split;           /* Internal : end of the arguments split so far */
+    size_t tail;            /* Internal : end of the bytes read */
+    long long next_index;   /* Internal : index of the argument at head */
+    int end_of_options;     /* Internal : "--" has been read */
+    int end_of_file;        /* Internal : read() has returned zero */
+} getopt_p_stream;
+
+void getopt_p_stream_init (getopt_p_stream * stream, int fd, int delim,
+    char * buf, size_t buf_size, const getopt_p_table * table,
+    const char * prog_name);
+int getopt_p_stream_next (getopt_p_stream * stream);
+
+
+#ifndef GETOPT_P_LONG_MAX
+#define GETOPT_P_LONG_MAX 1024  /* Most long options hashed, a power of two */
+#endif /* #ifndef GETOPT_P_LONG_MAX */
+
+/* Long options indexed by getopt_p_long_compile() with a perfect hash */
+typedef struct getopt_p_long_index {
+    const getopt_p_option * longopts;   /* Long options that are indexed */
+    int count;              /* Number of long options */
+    int hashed;             /* Flag for long options found by the hash */
+    unsigned slot_mask;     /* Number of hash slots less one */
+    unsigned short disp[GETOPT_P_LONG_MAX];     /* Displacement per bucket */
+    unsigned short slot[2 * GETOPT_P_LONG_MAX]; /* Long option index plus 1 */
+    unsigned short sorted[GETOPT_P_LONG_MAX];   /* Indices sorted by name */
+} getopt_p_long_index;
+
+int GETOPT_P_NAME(getopt_long) (int argc, char * const argv[],
+    const char * opt_str, const getopt_p_option * longopts, int * longindex);
+int GETOPT_P_NAME(getopt_long_only) (int argc, char * const argv[],
+    const char * opt_str, const getopt_p_option * longopts, int * longindex);
+int getopt_p_long_compile (getopt_p_long_index * index,
+    const getopt_p_option * longopts);
+int getopt_long_r (getopt_p_state * state, int argc, char * const argv[],
+    const char * opt_str, const getopt_p_long_index * index,
+    int * longindex);
+int getopt_long_only_r (getopt_p_state * state, int argc,
+    char * const argv[], const char * opt_str,
+    const getopt_p_long_index * index, int * longindex);
 
 
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
 
-#endif /* #ifndef _WIN32 */
+
+/* C++20 : option strings compiled and validated at compile time */
+#if defined(__cplusplus) && ((__cplusplus >= 202002L) || \
+    (defined(_MSVC_LANG) && (_MSVC_LANG >= 202002L)))
+
+#include <iterator>             /* std::default_sentinel_t */
+#include <span>                 /* std::span */
+#include <string_view>          /* std::string_view */
+#ifdef __cpp_impl_coroutine
+#include <coroutine>            /* std::coroutine_handle */
+#include <exception>            /* std::exception_ptr */
+#endif /* #ifdef __cpp_impl_coroutine */
+
+#ifndef GETOPT_P_FRAME_MAX
+#define GETOPT_P_FRAME_MAX 256  /* Bytes for a getopt_p::generate() frame */
+#endif /* #ifndef GETOPT_P_FRAME_MAX */
+
+namespace getopt_p {
+
+/* Option string literal usable as a template parameter */
+template <unsigned N>
+struct opt_string {
+    char str[N];    /* Copy of the literal, including the terminating '\0' */
+
+    consteval opt_string (const char (&literal)[N])
+    {
+        for (unsigned i = 0; i < N; i++) {
+            str[i] = literal[i];
+        }
+    }
+
+    /* '-' first requests in order operands, as per getopt() */
+    consteval bool in_order () const
+    {
+        return N > 1 && str[0] == '-';
+    }
+
+    /* ':' is only valid first, or following an option character */
+    consteval bool colon_option () const
+    {
+        unsigned first = in_order() ? 1 : 0;
+        return N > first + 2 && str[first] == ':' && str[first+1] == ':';
+    }
+
+    /* '-' as an option character is not POSIX compliant */
+    consteval bool dash_option () const
+    {
+        for (unsigned i = in_order() ? 1 : 0; i < N; i++) {
+            if (str[i] == '-') {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* Compile time equivalent of getopt_p_compile() */
+    consteval getopt_p_table compile () const
+    {
+        getopt_p_table table {};
+        table.in_order = in_order();
+        table.missing_colon = (str[table.in_order] == ':');
+        for (unsigned i = table.in_order; i + 1 < N; i++) {
+            unsigned char idx = (unsigned char)str[i];
+            if (str[i] == ':' || table.option_class[idx] != 0) {
+                continue;   /* ':' is never an option, first occurrence wins */
+            }
+            if (str[i+1] != ':') {
+                table.option_class[idx] = getopt_p_class_flag;
+            } else if (i + 2 < N && str[i+2] == ':') {
+                table.option_class[idx] = getopt_p_class_optional;
+            } else {
+                table.option_class[idx] = getopt_p_class_arg;
+            }
+        }
+        return table;
+    }
+};
+
+/* One option as yielded by getopt_p::options */
+struct parsed_option {
+    int option;             /* Return value of getopt_r(), '?' or ':' */
+    std::string_view arg;   /* Option argument, or empty with a NULL data() */
+    int index;              /* Index in argv of the entry with the option */
+    int err_kind;           /* getopt_p_error kind, zero for a valid option */
+
+    /* True if an argument was given, even an empty one */
+    bool has_arg () const
+    {
+        return arg.data() != nullptr;
+    }
+};
+
+/* Range of the options in argv, parsed as they are iterated */
+class options {
+public :
+    /* Parse with an option string, compiled in to the range itself */
+    options (int argc, char * const argv[], const char * opt_str,
+        bool print_errors = true)
+        : options(argc, argv, own_table, print_errors)
+    {
+        (void)getopt_p_compile(&own_table, opt_str);
+    }
+
+    /* Parse with a table compiled by getopt_p_compile() or parser<> */
+    options (int argc, char * const argv[], const getopt_p_table & table,
+        bool print_errors = true)
+        : state(GETOPT_P_STATE_INIT), argc(argc), argv(argv), table(&table)
+    {
+        state.opterr = print_errors;
+    }
+
+    /* The table may be held by the range, so it is never copied */
+    options (const options &) = delete;
+    options & operator= (const options &) = delete;
+
+    class iterator {
+    public :
+        using value_type = parsed_option;
+        using difference_type = std::ptrdiff_t;
+
+        iterator () = default;
+
+        explicit iterator (options * range)
+            : range(range)
+        {
+            ++*this;
+        }
+
+        const parsed_option & operator* () const
+        {
+            return current;
+        }
+
+        const parsed_option * operator-> () const
+        {
+            return &current;
+        }
+
+        iterator & operator++ ()
+        {
+            getopt_p_state & state = range->state;
+            current.index = state.optind;
+            current.option = getopt_compiled_r(&state, range->argc,
+                range->argv, range->table);
+            current.arg = (state.optarg != nullptr) ?
+                std::string_view(state.optarg) : std::string_view();
+            current.err_kind = state.err_kind;
+            return *this;
+        }
+
+        void operator++ (int)
+        {
+            ++*this;
+        }
+
+        bool operator== (std::default_sentinel_t) const
+        {
+            return current.option == -1;
+        }
+
+    private :
+        options * range = nullptr;
+        parsed_option current {};
+    };
+
+    iterator begin ()
+    {
+        return iterator(this);
+    }
+
+    std::default_sentinel_t end () const
+    {
+        return std::default_sentinel;
+    }
+
+    /* Operands not yet parsed, all of them once iteration has ended */
+    std::span<char * const> rest () const
+    {
+        int first = (state.optind < argc) ? state.optind : argc;
+        return std::span<char * const>(argv + first,
+            (std::size_t)(argc - first));
+    }
+
+    /* Parsing state, as per getopt_r() */
+    const getopt_p_state & parse_state () const
+    {
+        return state;
+    }
+
+private :
+    getopt_p_state state;
+    int argc;
+    char * const * argv;
+    const getopt_p_table * table;
+    getopt_p_table own_table;   /* Only used for a runtime option string */
+};
+
+/* Parser for an option string which is validated at compile time */
+template <opt_string S>
+struct parser {
+    static_assert(!S.colon_option(),
+        "getopt_p : ':' is not a valid option character");
+    static_assert(!S.dash_option(),
+        "getopt_p : '-' is not a valid option character");
+
+    static constexpr getopt_p_table table = S.compile();
+
+    /* As per getopt(), using the global variables */
+    static int next (int argc, char * const argv[])
+    {
+        return getopt_compiled(argc, argv, &table);
+    }
+
+    /* As per getopt_r(), using the supplied state */
+    static int next (getopt_p_state & state, int argc, char * const argv[])
+    {
+        return getopt_compiled_r(&state, argc, argv, &table);
+    }
+
+    /* As per getopt_p::options, with the compile time table */
+    static options parse (int argc, char * const argv[],
+        bool print_errors = true)
+    {
+        return options(argc, argv, table, print_errors);
+    }
+};
+
+#ifdef __cpp_impl_coroutine
+/* Caller supplied storage for the coroutine frame of getopt_p::generate() */
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) frame_buffer {
+    std::byte bytes[GETOPT_P_FRAME_MAX];
+};
+
+/* Options yielded one at a time by the coroutine getopt_p::generate() */
+class generator {
+public :
+    struct promise_type {
+        parsed_option current {};   /* Option most recently yielded */
+        std::exception_ptr error;   /* Exception thrown by an error handler */
+
+        generator get_return_object () noexcept
+        {
+            return generator(
+                std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        /* Frame did not fit, the generator is empty and failed() */
+        static generator get_return_object_on_allocation_failure () noexcept
+        {
+            return generator();
+        }
+
+        std::suspend_always initial_suspend () const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always final_suspend () const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always yield_value (const parsed_option & opt) noexcept
+        {
+            current = opt;
+            return {};
+        }
+
+        void return_void () const noexcept
+        {
+        }
+
+        /* Kept for next() to rethrow, rather than ending silently */
+        void unhandled_exception () noexcept
+        {
+            error = std::current_exception();
+        }
+
+        /*
+         * Frames are only ever placed in the caller's frame_buffer. The
+         * parameters are spelled out (not a template) as GCC otherwise
+         * warns that the usual operator delete does not match.
+         */
+        static void * operator new (std::size_t size, frame_buffer & buffer,
+            getopt_p_state &, int, char * const *,
+            const getopt_p_table &) noexcept
+        {
+            return (size <= sizeof(buffer.bytes)) ? buffer.bytes : nullptr;
+        }
+
+        static void operator delete (void *, std::size_t) noexcept
+        {
+        }
+    };
+
+    class iterator {
+    public :
+        using value_type = parsed_option;
+        using difference_type = std::ptrdiff_t;
+
+        iterator () = default;
+
+        explicit iterator (generator * gen)
+            : gen(gen)
+        {
+            ++*this;
+        }
+
+        const parsed_option & operator* () const
+        {
+            return gen->value();
+        }
+
+        const parsed_option * operator-> () const
+        {
+            return &gen->value();
+        }
+
+        iterator & operator++ ()
+        {
+            more = gen->next();
+            return *this;
+        }
+
+        void operator++ (int)
+        {
+            ++*this;
+        }
+
+        bool operator== (std::default_sentinel_t) const
+        {
+            return !more;
+        }
+
+    private :
+        generator * gen = nullptr;
+        bool more = false;
+    };
+
+    generator () = default;
+
+    generator (generator && other) noexcept
+        : handle(other.handle)
+    {
+        other.handle = nullptr;
+    }
+
+    generator & operator= (generator && other) noexcept
+    {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+        return *this;
+    }
+
+    ~generator ()
+    {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    /* True if the frame did not fit in the frame_buffer */
+    bool failed () const
+    {
+        return !handle;
+    }
+
+    /* Parse the next option, returning false after the last one; an
+     * exception thrown by an error handler is rethrown, once */
+    bool next ()
+    {
+        if (!handle || handle.done()) {
+            return false;
+        }
+        handle.resume();
+        if (handle.promise().error) {
+            std::exception_ptr error = handle.promise().error;
+            handle.promise().error = nullptr;
+            std::rethrow_exception(error);
+        }
+        return !handle.done();
+    }
+
+    /* Option parsed by the last successful next() */
+    const parsed_option & value () const
+    {
+        return handle.promise().current;
+    }
+
+    iterator begin ()
+    {
+        return iterator(this);
+    }
+
+    std::default_sentinel_t end () const
+    {
+        return std::default_sentinel;
+    }
+
+private :
+    explicit generator (std::coroutine_handle<promise_type> handle)
+        : handle(handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/* Coroutine parsing one option each time it is resumed, as per
+ * getopt_compiled_r() with the caller's state */
+inline generator generate (frame_buffer & buffer, getopt_p_state & state,
+    int argc, char * const argv[], const getopt_p_table & table)
+{
+    (void)buffer;   /* Only used to place the frame */
+    for (;;) {
+        parsed_option opt;
+        opt.index = (state.optind == 0) ? 1 :   /* Index once permuted */
+            (state.optind - state.operands_len);
+        opt.option = getopt_compiled_r(&state, argc, argv, &table);
+        if (opt.option == -1) {
+            co_return;
+        }
+        opt.arg = (state.optarg != nullptr) ?
+            std::string_view(state.optarg) : std::string_view();
+        opt.err_kind = state.err_kind;
+        co_yield opt;
+    }
+}
+#endif /* #ifdef __cpp_impl_coroutine */
+
+} /* namespace getopt_p */
+
+#endif /* C++20 */
+
+#endif /* #if defined(_WIN32) || defined(GETOPT_P_FORCE_PORTABLE) */
 
 #endif /* #ifndef GETOPT_P_H_INCLUDED */
 
@@ -167,12 +1379,20 @@ int getopt (int argc, char * const argv[], const char * opt_str);
 
 #ifdef GETOPT_P_IMPLEMENTATION
 
-/* Only build anything on Windows */
-#ifdef _WIN32
+/* Only build anything on Windows, unless the portable version is forced */
+#if defined(_WIN32) || defined(GETOPT_P_FORCE_PORTABLE)
 
-#include <windows.h>			/* _get_pgmptr */
-#include <string.h>				/* strcmp, strchr, strrchr */
-#include <stdio.h>				/* For printing errors (if opterr==1) */
+#ifdef _WIN32
+#include <windows.h>			/* _get_pgmptr, file mapping */
+#include <io.h>					/* _write */
+#else /* #ifdef _WIN32 */
+#include <fcntl.h>				/* open */
+#include <sys/mman.h>			/* mmap, munmap */
+#include <sys/stat.h>			/* fstat */
+#include <unistd.h>				/* read, write, close, sysconf */
+#include <errno.h>				/* errno, EINTR */
+#endif /* #ifdef _WIN32 */
+#include <string.h>				/* strcmp, strchr, strrchr, memset */
 #include <stddef.h>				/* NULL pointer */
 
 #ifdef __cplusplus
@@ -181,123 +1401,1986 @@ extern "C" {
 
 
 /* Global variables controlling the state of parsing. */
-const char * optarg = NULL; /* Pointer into argv to returns option argument */
-int optind = 1;             /* Index in argv of next element to be processed */
-int opterr = 1;             /* Flag to indicate if getopt() prints errors */
-int optopt = (int)'?';      /* Variable to return erroneous option character */
+/* Pointer into argv to returns option argument */
+GETOPT_P_TLS const char * GETOPT_P_NAME(optarg) = NULL;
+/* Index in argv of next element to be processed */
+GETOPT_P_TLS int GETOPT_P_NAME(optind) = 1;
+/* Flag to indicate if getopt() prints errors */
+GETOPT_P_TLS int GETOPT_P_NAME(opterr) = 1;
+/* Variable to return erroneous option character */
+GETOPT_P_TLS int GETOPT_P_NAME(optopt) = (int)'?';
+/* Flag to restart parsing from optind, as per BSD getopt() */
+GETOPT_P_TLS int GETOPT_P_NAME(optreset) = 0;
+/* Converted value of optarg for a typed option */
+GETOPT_P_TLS getopt_p_value getopt_p_optvalue = { 0 };
+
+/* Kind of an argv entry (internal linkage). */
+enum getopt_p_arg {
+    getopt_p_arg_operand = 0,   /* Operand, or NULL pointer */
+    getopt_p_arg_option = 1,    /* Entry with option character(s) */
+    getopt_p_arg_dash = 2,      /* "-" */
+    getopt_p_arg_dashdash = 3   /* "--" marking the end of options */
+};
+
+/* State behind getopt(), mirrored to and from the global variables. */
+static GETOPT_P_TLS getopt_p_state getopt_p_global = GETOPT_P_STATE_INIT;
+
+/* Long options of getopt_long(), indexed again when they change */
+static GETOPT_P_TLS getopt_p_long_index getopt_p_long_global;
+
+/* Error handler of a stream, called through getopt_p_stream_err() */
+typedef struct getopt_p_stream_err_ctx {
+    const getopt_p_stream * stream;     /* Stream being parsed */
+    getopt_p_error_fn err_fn;   /* Caller's error handler */
+    void * err_context;     /* Context pointer passed to err_fn */
+} getopt_p_stream_err_ctx;
 
 /* Utility functions are static (internal linkage). */
-static void getopt_p_print_err (const char * opt_str, const char * msg,
-    int option_char);
+static int getopt_p_global_next (int argc, char * const argv[],
+    const char * opt_str, const getopt_p_table * table,
+    const getopt_p_long_index * index, int long_only, int * longindex);
+static const getopt_p_long_index * getopt_p_long_global_index (
+    const getopt_p_option * longopts);
+static int getopt_p_long_next (getopt_p_state * state, int argc,
+    char * const argv[], const char * opt_str,
+    const getopt_p_long_index * index, int long_only, int * longindex);
+static int getopt_p_long_option (getopt_p_state * state, int argc,
+    char * const argv[], const char * opt_str,
+    const getopt_p_long_index * index, int found,
+    const unsigned short * candidates, int candidates_len, int * longindex);
+static int getopt_p_long_find (const getopt_p_long_index * index,
+    const char * name, size_t name_len, unsigned long hash, int long_only,
+    const unsigned short ** candidates, int * candidates_len);
+static int getopt_p_long_order (const getopt_p_option * longopts, int a,
+    int b);
+static unsigned long getopt_p_long_hash (const char * name,
+    size_t * name_len);
+static unsigned getopt_p_long_slot (unsigned long hash, unsigned disp,
+    unsigned slot_mask);
+static int getopt_p_next (getopt_p_state * state, int argc,
+    char * const argv[], const char * opt_str, const getopt_p_table * table,
+    const getopt_p_long_index * index, int long_only, int * longindex);
+static int getopt_p_short_next (getopt_p_state * state, int argc,
+    char * const argv[], const char * opt_str, const getopt_p_table * table);
+static void getopt_p_permute_end (getopt_p_state * state, char * args[],
+    int end);
+static int getopt_p_classify (const char * opt_str, int option_char);
+static int getopt_p_arg_kind (const char * arg);
+static int getopt_p_parse_u64 (const char * arg, size_t len, uint64_t limit,
+    uint64_t * value);
+static int getopt_p_parse_unit (int type, const char * arg,
+    uint64_t * value);
+static uint64_t getopt_p_load8 (const char * str);
+static uint64_t getopt_p_swar_between (uint64_t bytes, int low, int high);
+static const char * getopt_p_convert_msg (int type, int conv);
+static unsigned getopt_p_swar_match (unsigned long long bytes, int c);
+static int getopt_p_ctz (unsigned long long word);
+static int getopt_p_rsp_arg (getopt_p_rsp * rsp, char * arg, int depth,
+    char * rsp_argv[], int rsp_argv_max, int len);
+static int getopt_p_rsp_map_file (getopt_p_rsp * rsp, const char * path,
+    char ** text, size_t * size);
+static char * getopt_p_token (char ** pos, char * end);
+static int getopt_p_stream_fill (getopt_p_stream * stream, size_t offset,
+    size_t * len);
+static void getopt_p_stream_err (const getopt_p_error_info * info,
+    void * context);
+static void getopt_p_print_err (const getopt_p_state * state,
+    char * const argv[], int missing_colon, const char * msg,
+    getopt_p_error_info * info);
+static const char * getopt_p_prog_name (char * const argv[]);
+static size_t getopt_p_append (char * buf, size_t len, size_t size,
+    const char * str);
+
+
+int GETOPT_P_NAME(getopt) (int argc, char * const argv[],
+    const char * opt_str)
+{
+    return getopt_p_global_next(argc, argv, opt_str, NULL, NULL, 0, NULL);
+}
 
-/* Constants for return values in error states (internal linkage). */
-static const int getopt_p_option_unknown = (int)'?';
-static const int getopt_p_option_missing = (int)':';
 
+int getopt_compiled (int argc, char * const argv[],
+    const getopt_p_table * table)
+{
+    return getopt_p_global_next(argc, argv, NULL, table, NULL, 0, NULL);
+}
 
-int getopt (int argc, char * const argv[], const char * opt_str)
+
+int getopt_r (getopt_p_state * state, int argc, char * const argv[],
+    const char * opt_str)
 {
-    static int arg_idx = 0; /* Character index into current argv entry */
+    return getopt_p_next(state, argc, argv, opt_str, NULL, NULL, 0, NULL);
+}
 
-    optarg = NULL;          /* Default to no (empty) argument to option */
 
-    /* If starting a new argv, check if we already parsed all the options */
-    if (arg_idx == 0) {
-        if (optind >= argc ||           /* No more entries in argv */
-            argv[optind] == NULL ||     /* Null pointer in argv vector */
-            argv[optind][0] != '-' ||   /* First non-option in argv */
-            strcmp(argv[optind], "-") == 0) {   /* POSIX compliance */
-            return (int)-1;             /* Return "parsing complete" */
-        }
-        if (strcmp(argv[optind], "--") == 0) {  /* End of options */
-            optind++;                   /* Finished this argv entry, move on */
-            return (int)-1;             /* Return "parsing complete" */
-        }
-        arg_idx++;                      /* Advance index to option character */
-    }
+int getopt_compiled_r (getopt_p_state * state, int argc, char * const argv[],
+    const getopt_p_table * table)
+{
+    return getopt_p_next(state, argc, argv, NULL, table, NULL, 0, NULL);
+}
 
-    /* Get option character from argv entry */
-    int c = argv[optind][arg_idx];  /* Character to consider as an option */
-    optopt = c;
 
-    /* Check if current option character is one that was specified */
-    const char * cp = strchr(opt_str, (int)c);  /* Ptr to option in opt_str */
-    if (c == ':' || cp == NULL) {
-        getopt_p_print_err(opt_str, "invalid option", c);
-        arg_idx++;
-        if (argv[optind][arg_idx] == '\0') {
-            optind++;       /* Finished this argv entry, move on */
-            arg_idx = 0;    /* Reset to look at start of next argv entry */
-        }
-        return getopt_p_option_unknown;
-    }
+int GETOPT_P_NAME(getopt_long) (int argc, char * const argv[],
+    const char * opt_str, const getopt_p_option * longopts, int * longindex)
+{
+    return getopt_p_global_next(argc, argv, opt_str, NULL,
+        getopt_p_long_global_index(longopts), 0, longindex);
+}
 
-    /* Check if this option is specified to require an argument */
-    if (*(cp+1) == ':') {
-        /* Option string specifies the option needs an argument */
-        if (argv[optind][arg_idx+1] != '\0') {
-            /* Argument for this option embedded within this argv entry */
-            optarg = &argv[optind][arg_idx+1];
-        } else if ((optind+1) < argc) {
-            /* Argument for this option is in the next argv */
-            optind++;       /* Advance to next argv to find the argument */
-            optarg = argv[optind];
-        } else {
-            /* Argument for this option not in this argv and no more argv */
-			getopt_p_print_err(opt_str, "argument required for option", c);
-            optind++;       /* Finished this argv entry, move on */
-            arg_idx = 0;    /* Reset to look at start of next argv entry */
-            if (opt_str[0] == ':') {    /* POSIX compliant behaviour */
-                return getopt_p_option_missing;
-            } else {
-                return getopt_p_option_unknown;
-            }
-        }
-        optind++;           /* Finished this argv entry, move on */
-        arg_idx = 0;        /* Reset to look at start of next argv entry */
-    } else {
-        /* No argument expected */
-        arg_idx++;
-        if (argv[optind][arg_idx] == '\0') {
-            optind++;       /* Finished this argv entry, move on */
-            arg_idx = 0;    /* Reset to look at start of next argv entry */
-        }
-        optarg = NULL;
-    }
 
-    /* Return the option character that we found */
-    return c;
+int GETOPT_P_NAME(getopt_long_only) (int argc, char * const argv[],
+    const char * opt_str, const getopt_p_option * longopts, int * longindex)
+{
+    return getopt_p_global_next(argc, argv, opt_str, NULL,
+        getopt_p_long_global_index(longopts), 1, longindex);
 }
 
 
-static void getopt_p_print_err (const char * opt_str, const char * msg,
-    int option_char)
+int getopt_long_r (getopt_p_state * state, int argc, char * const argv[],
+    const char * opt_str, const getopt_p_long_index * index,
+    int * longindex)
 {
-    /* Report the error, based on runtime configuration */
-    if (opterr && (opt_str[0] != ':')) {
-        /* Get the program name to use while reporting the error */
-        char * name_ptr;    /* Pointer rather than buffer is OK */
-        if (_get_pgmptr(&name_ptr) == 0) {
-            const char * short_name = strrchr(name_ptr, (int)'\\');
-            if (short_name) {
-                name_ptr = (char *)(short_name+1);
-            }
-        } else {
-            name_ptr = "Error";
-        }
-        /* Now report the error */
-        (void)fprintf(stderr, "%s : %s '-%c'\n", name_ptr, msg,
-            (char)option_char);
-    }
-    return;
+    return getopt_p_next(state, argc, argv, opt_str, NULL, index, 0,
+        longindex);
 }
 
 
-#ifdef __cplusplus
+int getopt_long_only_r (getopt_p_state * state, int argc,
+    char * const argv[], const char * opt_str,
+    const getopt_p_long_index * index, int * longindex)
+{
+    return getopt_p_next(state, argc, argv, opt_str, NULL, index, 1,
+        longindex);
 }
-#endif /* __cplusplus */
 
-#endif /* #ifdef _WIN32 */
+
+void getopt_p_state_init (getopt_p_state * state)
+{
+    const getopt_p_state initial = GETOPT_P_STATE_INIT;
+    *state = initial;
+    return;
+}
+
+
+void getopt_p_set_error_fn (getopt_p_error_fn err_fn, void * err_context)
+{
+    getopt_p_global.err_fn = err_fn;
+    getopt_p_global.err_context = err_context;
+    return;
+}
+
+
+void getopt_p_set_permute (char * operands[], int operands_max)
+{
+    getopt_p_global.operands = operands;
+    getopt_p_global.operands_max = operands_max;
+    getopt_p_global.operands_len = 0;
+    return;
+}
+
+
+int getopt_p_parse_all (getopt_p_state * state, int argc, char * const argv[],
+    const getopt_p_table * table, getopt_p_result * results, int results_max,
+    int * results_len)
+{
+    int len = 0;            /* Number of records written to results */
+
+    while (len < results_max) {
+        /*
+         * Note where the option is before parsing moves past it. When
+         * permuting, the entry is moved down past the operands set aside,
+         * so it ends up at optind less their number (any operands this
+         * call skips are set aside and the entry moved by as many).
+         */
+        getopt_p_result * result = &results[len];
+        result->argv_idx = (state->optind == 0) ? 1 :
+            (state->optind - state->operands_len);
+        result->char_idx = (state->arg_idx == 0) ? 1 : state->arg_idx;
+
+        if (getopt_p_next(state, argc, argv, NULL, table, NULL, 0, NULL) ==
+            -1) {
+            *results_len = len;
+            return state->optind;   /* Index of the first operand */
+        }
+        result->optarg = state->optarg;
+        result->option = (char)state->optopt;
+        result->err_kind = (char)state->err_kind;
+        len++;
+    }
+
+    /* Out of space for records; the caller may continue with more space */
+    *results_len = len;
+    return (int)-1;
+}
+
+
+int getopt_p_batch_parse (getopt_p_batch * batch)
+{
+    int parsed = 0;         /* Number of jobs parsed by this caller */
+
+    for (;;) {
+        /* Claim the next job; threads finishing early simply claim more */
+#if defined(_WIN32)
+        long job_idx = InterlockedExchangeAdd(&batch->next_job, 1);
+#elif defined(__GNUC__) || defined(__clang__)
+        long job_idx = __atomic_fetch_add(&batch->next_job, 1,
+            __ATOMIC_RELAXED);
+#else /* No atomic add, so only one caller at a time */
+        long job_idx = batch->next_job++;
+#endif /* #if defined(_WIN32) */
+        if (job_idx >= batch->jobs_len) {
+            return parsed;
+        }
+
+        /* Each job has its own state and records, so nothing is shared */
+        getopt_p_job * job = &batch->jobs[job_idx];
+        getopt_p_state state = GETOPT_P_STATE_INIT;
+        state.opterr = 0;   /* Errors are in the records, not printed */
+        job->first_operand = getopt_p_parse_all(&state, job->argc,
+            job->argv, batch->table, job->results, job->results_max,
+            &job->results_len);
+        parsed++;
+    }
+}
+
+
+int getopt_p_merge (getopt_p_layer * layers, int layers_len,
+    const getopt_p_table * table, const char * accumulate,
+    int print_errors, getopt_p_setting settings[256])
+{
+    int errors = 0;         /* Number of errors found in all layers */
+    unsigned char accumulated[256];     /* Non-zero to count every layer */
+    (void)memset(accumulated, 0, sizeof(accumulated));
+    for (const char * cp = accumulate; cp != NULL && *cp != '\0'; cp++) {
+        accumulated[(unsigned char)*cp] = 1;
+    }
+    for (int c = 0; c < 256; c++) {
+        settings[c].value = NULL;
+        settings[c].layer = -1;
+        settings[c].count = 0;
+    }
+
+    /* Lowest precedence first, so every later occurrence wins */
+    for (int layer = 0; layer < layers_len; layer++) {
+        getopt_p_state state = GETOPT_P_STATE_INIT;
+        state.opterr = print_errors;
+        int c;
+        while ((c = getopt_p_next(&state, layers[layer].argc,
+            layers[layer].argv, NULL, table, NULL, 0, NULL)) != -1) {
+            if (state.err_kind != getopt_p_option_valid) {
+                errors++;
+                continue;
+            }
+            if (c == 1) {
+                continue;       /* In order operand, not an option */
+            }
+            getopt_p_setting * setting = &settings[(unsigned char)c];
+            if (setting->layer != layer && !accumulated[(unsigned char)c]) {
+                setting->count = 0;     /* Earlier layers are overridden */
+            }
+            setting->value = state.optarg;
+            setting->layer = layer;
+            setting->count++;
+        }
+        layers[layer].first_operand = state.optind;
+    }
+    return errors;
+}
+
+
+int getopt_p_validate (int argc, char * const argv[],
+    const getopt_p_table * table, getopt_p_result * diags, int diags_max)
+{
+    getopt_p_state state = GETOPT_P_STATE_INIT;
+    int errors = 0;         /* Number of errors found, recorded or not */
+    state.opterr = 0;       /* Validation never prints */
+
+    for (;;) {
+        /* Note where the option is before parsing moves past it */
+        int argv_idx = state.optind;
+        int char_idx = (state.arg_idx == 0) ? 1 : state.arg_idx;
+
+        if (getopt_p_next(&state, argc, argv, NULL, table, NULL, 0, NULL) ==
+            -1) {
+            return errors;
+        }
+        if (state.err_kind == getopt_p_option_valid) {
+            continue;
+        }
+        if (errors < diags_max) {
+            getopt_p_result * diag = &diags[errors];
+            diag->optarg = NULL;
+            diag->argv_idx = argv_idx;
+            diag->char_idx = char_idx;
+            diag->option = (char)state.optopt;
+            diag->err_kind = (char)state.err_kind;
+        }
+        errors++;
+    }
+}
+
+
+int getopt_p_rsp_expand (getopt_p_rsp * rsp, int argc, char * const argv[],
+    char * rsp_argv[], int rsp_argv_max)
+{
+    int len = 0;            /* Number of entries written to rsp_argv */
+
+    /* The program name is never a response file */
+    if (argc > 0) {
+        if (rsp_argv_max < 1) {
+            return (int)-1;
+        }
+        rsp_argv[len++] = argv[0];
+    }
+    for (int i = 1; i < argc && len >= 0; i++) {
+        len = getopt_p_rsp_arg(rsp, argv[i], 0, rsp_argv, rsp_argv_max, len);
+    }
+
+    /* Terminate the new argv with a NULL pointer, as for main() */
+    if (len < 0 || len >= rsp_argv_max) {
+        return (int)-1;
+    }
+    rsp_argv[len] = NULL;
+    return len;
+}
+
+
+int getopt_p_env_expand (const char * value, char * buf, size_t buf_size,
+    int argc, char * const argv[], char * env_argv[], int env_argv_max)
+{
+    int len = 0;            /* Number of entries written to env_argv */
+
+    /* The program name stays first, ahead of the variable's arguments */
+    if (argc > 0) {
+        if (env_argv_max < 1) {
+            return (int)-1;
+        }
+        env_argv[len++] = argv[0];
+    }
+
+    /* One copy of the value, then split in place as for a response file */
+    if (value != NULL) {
+        size_t size = strlen(value);
+        if (size >= buf_size) {
+            return (int)-1;     /* Out of space in buf for the '\0' */
+        }
+        (void)memcpy(buf, value, size + 1);
+        char * pos = buf;       /* Position of the next token in buf */
+        char * token;
+        while ((token = getopt_p_token(&pos, buf + size)) != NULL) {
+            if (len >= env_argv_max) {
+                return (int)-1;
+            }
+            env_argv[len++] = token;
+        }
+    }
+
+    /* Then the real arguments, so that they take precedence */
+    for (int i = 1; i < argc; i++) {
+        if (len >= env_argv_max) {
+            return (int)-1;
+        }
+        env_argv[len++] = argv[i];
+    }
+    if (len >= env_argv_max) {
+        return (int)-1;
+    }
+    env_argv[len] = NULL;
+    return len;
+}
+
+
+void getopt_p_scan (int argc, char * const argv[], unsigned long long option[],
+    unsigned long long dash[], unsigned long long dashdash[],
+    unsigned long long operand[])
+{
+    /*
+     * The first three bytes of eight entries at a time are gathered in to
+     * words and classified together (SWAR). A byte is only read if all the
+     * bytes before it are non-zero, so no read goes past a terminator.
+     */
+    for (int word_idx = 0; word_idx < GETOPT_P_SCAN_WORDS(argc); word_idx++) {
+        unsigned long long option_word = 0, dash_word = 0;
+        unsigned long long dashdash_word = 0, operand_word = 0;
+        for (int block = 0; block < 64; block += 8) {
+            int idx = word_idx * 64 + block;  /* argv index of first entry */
+            int count = (argc - idx < 8) ? (argc - idx) : 8;
+            if (count <= 0) {
+                break;
+            }
+            unsigned long long byte0 = 0, byte1 = 0, byte2 = 0;
+            for (int k = 0; k < count; k++) {
+                const char * arg = (argv[idx+k] != NULL) ? argv[idx+k] : "";
+                int idx1 = (arg[0] != '\0');
+                int idx2 = idx1 + (arg[idx1] != '\0');
+                byte0 |= (unsigned long long)(unsigned char)arg[0] << (8*k);
+                byte1 |= (unsigned long long)(unsigned char)arg[idx1] << (8*k);
+                byte2 |= (unsigned long long)(unsigned char)arg[idx2] << (8*k);
+            }
+            unsigned valid = (count == 8) ? 0xffu : ((1u << count) - 1u);
+            unsigned dash0 = getopt_p_swar_match(byte0, '-');
+            unsigned end1 = getopt_p_swar_match(byte1, '\0');
+            unsigned dash1 = getopt_p_swar_match(byte1, '-');
+            unsigned end2 = getopt_p_swar_match(byte2, '\0');
+            unsigned is_dash = dash0 & end1;
+            unsigned is_dashdash = dash0 & dash1 & end2;
+            unsigned is_option = dash0 & ~end1 & ~is_dashdash;
+            unsigned is_operand = valid & ~dash0;
+            option_word |= (unsigned long long)is_option << block;
+            dash_word |= (unsigned long long)is_dash << block;
+            dashdash_word |= (unsigned long long)is_dashdash << block;
+            operand_word |= (unsigned long long)is_operand << block;
+        }
+        if (option != NULL) {
+            option[word_idx] = option_word;
+        }
+        if (dash != NULL) {
+            dash[word_idx] = dash_word;
+        }
+        if (dashdash != NULL) {
+            dashdash[word_idx] = dashdash_word;
+        }
+        if (operand != NULL) {
+            operand[word_idx] = operand_word;
+        }
+    }
+    return;
+}
+
+
+int getopt_p_scan_next (const unsigned long long mask[], int from, int argc)
+{
+    /* Skip whole words of clear bits at a time */
+    int idx = from;
+    while (idx < argc) {
+        unsigned long long word = mask[idx / 64] >> (idx % 64);
+        if (word != 0) {
+            idx += getopt_p_ctz(word);
+            return (idx < argc) ? idx : argc;
+        }
+        idx = (idx / 64 + 1) * 64;
+    }
+    return argc;
+}
+
+
+void getopt_p_rsp_release (getopt_p_rsp * rsp)
+{
+    for (int i = 0; i < rsp->maps_len; i++) {
+#ifdef _WIN32
+        (void)UnmapViewOfFile(rsp->maps[i].base);
+#else /* #ifdef _WIN32 */
+        (void)munmap(rsp->maps[i].base, rsp->maps[i].size);
+#endif /* #ifdef _WIN32 */
+    }
+    rsp->maps_len = 0;
+    return;
+}
+
+
+void getopt_p_stream_init (getopt_p_stream * stream, int fd, int delim,
+    char * buf, size_t buf_size, const getopt_p_table * table,
+    const char * prog_name)
+{
+    (void)memset(stream, 0, sizeof(*stream));
+    getopt_p_state_init(&stream->state);
+    stream->table = table;
+    stream->prog_name = prog_name;
+    stream->fd = fd;
+    stream->delim = delim;
+    stream->buf = buf;
+    stream->buf_size = buf_size;
+    return;
+}
+
+
+int getopt_p_stream_next (getopt_p_stream * stream)
+{
+    getopt_p_state * state = &stream->state;
+    size_t len;             /* Length of the argument at head */
+
+    /* Operands (and "--") are returned without the getopt() machinery */
+    for (;;) {
+        if (getopt_p_stream_fill(stream, 0, &len) <= 0) {
+            state->optarg = NULL;
+            return (int)-1;     /* End of the stream, or an error */
+        }
+        char * arg = stream->buf + stream->head;
+        int kind = getopt_p_arg_kind(arg);
+        if (state->arg_idx != 0 ||
+            (kind == getopt_p_arg_option && !stream->end_of_options)) {
+            break;
+        }
+        stream->index = stream->next_index++;
+        stream->head += len + 1;
+        if (stream->end_of_options || kind != getopt_p_arg_dashdash) {
+            state->optarg = arg;
+            state->err_kind = getopt_p_option_valid;
+            return 1;           /* Operand, as for a leading '-' */
+        }
+        stream->end_of_options = 1;
+    }
+
+    /*
+     * The option is parsed as per getopt() from a window of argv holding
+     * the current argument and, only when its last option requires an
+     * argument, the following one. Reading no further ahead than that
+     * means an interactive stream is never waited on needlessly.
+     */
+    char * argv[4];
+    int argc = 2;
+    argv[0] = (char *)stream->prog_name;
+    argv[1] = stream->buf + stream->head;
+    argv[2] = NULL;
+    int arg_idx = (state->arg_idx == 0) ? 1 : state->arg_idx;
+    if (stream->table->option_class[(unsigned char)argv[1][arg_idx]] ==
+        getopt_p_class_arg && argv[1][arg_idx+1] == '\0') {
+        size_t next_len;
+        int got = getopt_p_stream_fill(stream, len + 1, &next_len);
+        if (got < 0) {
+            return (int)-1;
+        }
+        argv[1] = stream->buf + stream->head;   /* The buffer may have moved */
+        if (got > 0) {
+            argv[2] = argv[1] + len + 1;
+            argc = 3;
+        }
+    }
+    argv[argc] = NULL;
+
+    /* Errors are passed to a handler with their index in the stream */
+    getopt_p_stream_err_ctx err_ctx = { stream, state->err_fn,
+        state->err_context };
+    if (state->err_fn != NULL) {
+        state->err_fn = getopt_p_stream_err;
+        state->err_context = &err_ctx;
+    }
+    state->optind = 1;
+    int c = getopt_p_next(state, argc, argv, NULL, stream->table, NULL, 0,
+        NULL);
+    state->err_fn = err_ctx.err_fn;
+    state->err_context = err_ctx.err_context;
+    stream->index = stream->next_index;
+    for (int i = 1; i < state->optind; i++) {
+        stream->head += strlen(argv[i]) + 1;    /* Finished with argument */
+        stream->next_index++;
+    }
+    return c;
+}
+
+
+int getopt_p_compile (getopt_p_table * table, const char * opt_str)
+{
+    if (table == NULL || opt_str == NULL) {
+        return (int)-1;
+    }
+
+    (void)memset(table->option_class, getopt_p_class_unknown,
+        sizeof(table->option_class));
+    (void)memset(table->option_type, getopt_p_type_none,
+        sizeof(table->option_type));
+    table->in_order = (opt_str[0] == '-');
+    if (table->in_order) {
+        opt_str++;          /* '-' is a flag, not an option character */
+    }
+    table->missing_colon = (opt_str[0] == ':');
+
+    /* Classify each option character the same way getopt() would */
+    for (const char * cp = opt_str; *cp != '\0'; cp++) {
+        unsigned char idx = (unsigned char)*cp;
+        if (*cp == ':' || table->option_class[idx] != getopt_p_class_unknown) {
+            continue;   /* ':' is never an option, first occurrence wins */
+        }
+        table->option_class[idx] = (unsigned char)getopt_p_classify(opt_str,
+            *cp);
+    }
+    return 0;
+}
+
+
+int getopt_p_set_type (getopt_p_table * table, int option, int type)
+{
+    /* Only an option which takes an argument has anything to convert */
+    unsigned char idx = (unsigned char)option;
+    if (table == NULL || type < getopt_p_type_none ||
+        type > getopt_p_type_duration ||
+        table->option_class[idx] == getopt_p_class_unknown ||
+        table->option_class[idx] == getopt_p_class_flag) {
+        return (int)-1;
+    }
+    table->option_type[idx] = (unsigned char)type;
+    return 0;
+}
+
+
+int getopt_p_convert (int type, const char * arg, getopt_p_value * value)
+{
+    if (type == getopt_p_type_bool) {
+        /* Compare case insensitively with each spelling of true and false */
+        static const char * const names[8] = { "1", "0", "true", "false",
+            "yes", "no", "on", "off" };
+        for (int i = 0; i < 8; i++) {
+            const char * name = names[i];
+            const char * cp = arg;
+            while (*name != '\0' && ((*cp >= 'A' && *cp <= 'Z') ?
+                (*cp | 0x20) : *cp) == *name) {
+                name++;
+                cp++;
+            }
+            if (*name == '\0' && *cp == '\0') {
+                value->boolean = ((i & 1) == 0);
+                return getopt_p_convert_ok;
+            }
+        }
+        return getopt_p_convert_syntax;
+    }
+    if (type == getopt_p_type_size || type == getopt_p_type_duration) {
+        return getopt_p_parse_unit(type, arg, &value->u64);
+    }
+
+    /* Numbers are converted as a magnitude up to the limit of their type */
+    int negative = (arg[0] == '-');
+    if ((arg[0] == '-' && type != getopt_p_type_uint64) || arg[0] == '+') {
+        arg++;
+    }
+    uint64_t limit = (type == getopt_p_type_int32) ?
+        (uint64_t)INT32_MAX + (uint64_t)negative :
+        (type == getopt_p_type_int64) ?
+        (uint64_t)INT64_MAX + (uint64_t)negative : UINT64_MAX;
+    uint64_t magnitude;
+    int conv = getopt_p_parse_u64(arg, strlen(arg), limit, &magnitude);
+    if (conv != getopt_p_convert_ok) {
+        return conv;
+    }
+    if (type == getopt_p_type_uint64) {
+        value->u64 = magnitude;
+    } else {
+        /* Negate without overflow, even for the most negative value */
+        int64_t signed_value = negative ?
+            -(int64_t)(magnitude - (magnitude > 0)) - (magnitude > 0) :
+            (int64_t)magnitude;
+        if (type == getopt_p_type_int32) {
+            value->i32 = (int32_t)signed_value;
+        } else {
+            value->i64 = signed_value;
+        }
+    }
+    return getopt_p_convert_ok;
+}
+
+
+int getopt_p_long_compile (getopt_p_long_index * index,
+    const getopt_p_option * longopts)
+{
+    int head[GETOPT_P_LONG_MAX];    /* First long option in each bucket */
+    int next[GETOPT_P_LONG_MAX];    /* Next long option in the same bucket */
+    unsigned long hashes[GETOPT_P_LONG_MAX];    /* Hash of each name */
+    int count = 0;
+
+    while (longopts[count].name != NULL) {
+        count++;
+    }
+    index->longopts = longopts;
+    index->count = count;
+    index->hashed = 0;      /* Any failure leaves a linear search */
+    if (count > GETOPT_P_LONG_MAX) {
+        return (int)-1;
+    }
+
+    /* Sort by name for abbreviations (shell sort, no dynamic memory) */
+    for (int i = 0; i < count; i++) {
+        index->sorted[i] = (unsigned short)i;
+    }
+    for (int gap = count / 2; gap > 0; gap /= 2) {
+        for (int i = gap; i < count; i++) {
+            unsigned short moving = index->sorted[i];
+            int j;
+            for (j = i; j >= gap && getopt_p_long_order(longopts,
+                index->sorted[j-gap], moving) > 0; j -= gap) {
+                index->sorted[j] = index->sorted[j-gap];
+            }
+            index->sorted[j] = moving;
+        }
+    }
+
+    /* At most half the slots are used, with about one name per bucket */
+    unsigned slots = 2;
+    while (slots < 2 * (unsigned)count) {
+        slots *= 2;
+    }
+    unsigned buckets = slots / 2;
+    index->slot_mask = slots - 1;
+    memset(index->slot, 0, slots * sizeof(index->slot[0]));
+
+    /* Hash each name in to a bucket, leaving out repeated names */
+    int bucket_max = 0;     /* Most names in a bucket */
+    for (unsigned b = 0; b < buckets; b++) {
+        head[b] = (int)-1;
+        index->disp[b] = 0;
+    }
+    for (int i = 0; i < count; i++) {
+        size_t name_len;
+        hashes[i] = getopt_p_long_hash(longopts[i].name, &name_len);
+        unsigned b = (unsigned)hashes[i] & (buckets - 1);
+        int size = 1;
+        int j;
+        for (j = head[b]; j != -1; j = next[j]) {
+            if (strcmp(longopts[i].name, longopts[j].name) == 0) {
+                break;      /* Only the first of a repeated name can match */
+            }
+            size++;
+        }
+        if (j == -1) {
+            next[i] = head[b];
+            head[b] = i;
+            bucket_max = (size > bucket_max) ? size : bucket_max;
+        }
+    }
+
+    /* Place the fullest buckets first, while most slots are free */
+    for (int size = bucket_max; size > 0; size--) {
+        for (unsigned b = 0; b < buckets; b++) {
+            int bucket_size = 0;
+            for (int j = head[b]; j != -1; j = next[j]) {
+                bucket_size++;
+            }
+            if (bucket_size != size) {
+                continue;
+            }
+
+            /* Find a displacement moving every name to a free slot */
+            unsigned disp;
+            for (disp = 0; disp <= 0xFFFF; disp++) {
+                int j;
+                for (j = head[b]; j != -1; j = next[j]) {
+                    unsigned slot = getopt_p_long_slot(hashes[j], disp,
+                        index->slot_mask);
+                    if (index->slot[slot] != 0) {
+                        break;
+                    }
+                    index->slot[slot] = (unsigned short)(j + 1);
+                }
+                if (j == -1) {
+                    break;  /* Every name of the bucket placed */
+                }
+                for (int k = head[b]; k != j; k = next[k]) {
+                    index->slot[getopt_p_long_slot(hashes[k], disp,
+                        index->slot_mask)] = 0;
+                }
+            }
+            if (disp > 0xFFFF) {
+                return (int)-1;     /* Only for names with the same hash */
+            }
+            index->disp[b] = (unsigned short)disp;
+        }
+    }
+    index->hashed = 1;
+    return 0;
+}
+
+
+static int getopt_p_global_next (int argc, char * const argv[],
+    const char * opt_str, const getopt_p_table * table,
+    const getopt_p_long_index * index, int long_only, int * longindex)
+{
+    getopt_p_state * state = &getopt_p_global;
+
+    /* The caller may have changed optind or opterr since the last call */
+    if (GETOPT_P_NAME(optind) != state->optind || GETOPT_P_NAME(optreset)) {
+        /* Restart at the new optind, rather than part way through argv */
+        state->optind = GETOPT_P_NAME(optind);
+        state->arg_idx = 0;
+        state->operands_len = 0;
+        GETOPT_P_NAME(optreset) = 0;
+    }
+    state->opterr = GETOPT_P_NAME(opterr);
+
+    int c = getopt_p_next(state, argc, argv, opt_str, table, index,
+        long_only, longindex);
+
+    GETOPT_P_NAME(optarg) = state->optarg;
+    GETOPT_P_NAME(optind) = state->optind;
+    GETOPT_P_NAME(optopt) = state->optopt;
+    getopt_p_optvalue = state->optvalue;
+    return c;
+}
+
+
+static int getopt_p_next (getopt_p_state * state, int argc,
+    char * const argv[], const char * opt_str, const getopt_p_table * table,
+    const getopt_p_long_index * index, int long_only, int * longindex)
+{
+    /* As per GNU getopt(), optind of zero restarts parsing from scratch */
+    if (state->optind == 0) {
+        state->optind = 1;
+        state->arg_idx = 0;
+        state->operands_len = 0;
+    }
+
+    /* In order, operands are returned as the argument of option 1 */
+    int in_order = (table != NULL) ? table->in_order : (opt_str[0] == '-');
+    if (in_order && state->arg_idx == 0 && state->optind < argc &&
+        (getopt_p_arg_kind(argv[state->optind]) == getopt_p_arg_operand ||
+        getopt_p_arg_kind(argv[state->optind]) == getopt_p_arg_dash)) {
+        state->optarg = argv[state->optind];
+        state->optopt = 1;
+        state->err_kind = getopt_p_option_valid;
+        state->optind++;        /* Finished this argv entry, move on */
+        return 1;
+    }
+
+    if (state->operands == NULL) {
+        /* POSIX behaviour, stopping at the first operand */
+        if (index != NULL) {
+            return getopt_p_long_next(state, argc, argv, opt_str, index,
+                long_only, longindex);
+        }
+        return getopt_p_short_next(state, argc, argv, opt_str, table);
+    }
+
+    /*
+     * Permuting (as per GNU, argv is rewritten despite being const). Each
+     * operand is set aside in operands as it is passed, and each finished
+     * option entry is moved down next to the options before it, so that
+     * argv[first..optind) always holds exactly the operands set aside.
+     * Every entry moves at most twice, so permuting is linear in argc.
+     */
+    char ** args = (char **)argv;
+    if (state->arg_idx == 0) {
+        while (state->optind < argc &&
+            (getopt_p_arg_kind(argv[state->optind]) == getopt_p_arg_operand ||
+            getopt_p_arg_kind(argv[state->optind]) == getopt_p_arg_dash)) {
+            if (state->operands_len == state->operands_max) {
+                /* No room for more operands, stop as if at the end */
+                getopt_p_permute_end(state, args, state->optind);
+                state->optarg = NULL;
+                state->err_kind = getopt_p_option_valid;
+                return (int)-1;
+            }
+            state->operands[state->operands_len++] = args[state->optind++];
+        }
+    }
+    int start = state->optind;  /* Entry of the option about to be parsed */
+    int first = start - state->operands_len;    /* First operand set aside */
+
+    int c;
+    if (index != NULL) {
+        c = getopt_p_long_next(state, argc, argv, opt_str, index, long_only,
+            longindex);
+    } else {
+        c = getopt_p_short_next(state, argc, argv, opt_str, table);
+    }
+
+    /* Move finished entries (including any "--") down past the operands */
+    if (state->arg_idx == 0 && first != start) {
+        for (int i = start; i < state->optind; i++) {
+            args[first++] = args[i];
+        }
+    }
+    if (c == -1) {
+        /* Options done, put the operands back after the options */
+        getopt_p_permute_end(state, args, state->optind);
+    }
+    return c;
+}
+
+
+static void getopt_p_permute_end (getopt_p_state * state, char * args[],
+    int end)
+{
+    /* Return the operands set aside to argv, ending at argv[end] */
+    int first = end - state->operands_len;
+    for (int i = 0; i < state->operands_len; i++) {
+        args[first+i] = state->operands[i];
+    }
+    state->operands_len = 0;
+    state->optind = first;      /* As per POSIX, the first operand */
+    return;
+}
+
+
+static int getopt_p_short_next (getopt_p_state * state, int argc,
+    char * const argv[], const char * opt_str, const getopt_p_table * table)
+{
+    state->optarg = NULL;   /* Default to no (empty) argument to option */
+    state->err_kind = getopt_p_option_valid;
+
+    /* If starting a new argv, check if we already parsed all the options */
+    if (state->arg_idx == 0) {
+        const char * arg = (state->optind < argc) ? argv[state->optind] : NULL;
+        int kind = getopt_p_arg_kind(arg);
+        if (kind != getopt_p_arg_option) {
+            /* No more entries, a non-option or "-" (POSIX compliance) */
+            if (kind == getopt_p_arg_dashdash) {    /* End of options */
+                state->optind++;        /* Finished this argv entry, move on */
+            }
+            return (int)-1;             /* Return "parsing complete" */
+        }
+        state->arg_idx++;               /* Advance index to option character */
+    }
+
+    /* Get option character from argv entry */
+    const char * arg = argv[state->optind]; /* Current argv entry */
+    int arg_idx = state->arg_idx;   /* Character index into argv entry */
+    int c = arg[arg_idx];           /* Character to consider as an option */
+    state->optopt = c;
+
+    /* Check if current option character is one that was specified */
+    int opt_class;          /* Classification of the option character */
+    int missing_colon;      /* Flag for ':' first in the option string */
+    if (table != NULL) {
+        opt_class = table->option_class[(unsigned char)c];
+        missing_colon = table->missing_colon;
+    } else {
+        opt_class = getopt_p_classify(opt_str, c);
+        missing_colon = (opt_str[0] == ':' ||
+            (opt_str[0] == '-' && opt_str[1] == ':'));
+    }
+    getopt_p_error_info info;   /* Details of any error */
+    if (opt_class == getopt_p_class_unknown) {
+        state->err_kind = getopt_p_option_unknown;
+        memset(&info, 0, sizeof(info));
+        info.option = c;
+        info.argv_idx = state->optind;
+        getopt_p_print_err(state, argv, missing_colon, "invalid option",
+            &info);
+        arg_idx++;
+        if (arg[arg_idx] == '\0') {
+            state->optind++;    /* Finished this argv entry, move on */
+            arg_idx = 0;        /* Reset to look at start of next argv entry */
+        }
+        state->arg_idx = arg_idx;
+        return getopt_p_option_unknown;
+    }
+
+    /* Check if this option is specified to take an argument */
+    if (opt_class != getopt_p_class_flag) {
+        int opt_idx = state->optind;    /* Index of the entry with option */
+        /* Option string specifies the option needs an argument */
+        if (arg[arg_idx+1] != '\0') {
+            /* Argument for this option embedded within this argv entry */
+            state->optarg = &arg[arg_idx+1];
+        } else if (opt_class == getopt_p_class_optional) {
+            /* An optional-argument is only ever embedded, so there is none */
+        } else if ((state->optind+1) < argc) {
+            /* Argument for this option is in the next argv */
+            state->optind++;    /* Advance to next argv to find the argument */
+            state->optarg = argv[state->optind];
+        } else {
+            /* Argument for this option not in this argv and no more argv */
+            state->err_kind = getopt_p_option_missing;
+            memset(&info, 0, sizeof(info));
+            info.option = c;
+            info.argv_idx = opt_idx;
+            getopt_p_print_err(state, argv, missing_colon,
+                "argument required for option", &info);
+            state->optind++;    /* Finished this argv entry, move on */
+            state->arg_idx = 0; /* Reset to look at start of next argv entry */
+            if (missing_colon) {    /* POSIX compliant behaviour */
+                return getopt_p_option_missing;
+            } else {
+                return getopt_p_option_unknown;
+            }
+        }
+        state->optind++;        /* Finished this argv entry, move on */
+        arg_idx = 0;            /* Reset to look at start of next argv entry */
+
+        /* Convert the argument of a typed option (compiled tables only) */
+        int type = (table != NULL) ?
+            table->option_type[(unsigned char)c] : (int)getopt_p_type_none;
+        int conv = (type != getopt_p_type_none && state->optarg != NULL) ?
+            getopt_p_convert(type, state->optarg, &state->optvalue) :
+            getopt_p_convert_ok;
+        if (conv != getopt_p_convert_ok) {
+            state->arg_idx = 0;
+            state->err_kind = getopt_p_option_invalid;
+            memset(&info, 0, sizeof(info));
+            info.option = c;
+            info.argv_idx = opt_idx;
+            info.optarg = state->optarg;
+            getopt_p_print_err(state, argv, missing_colon,
+                getopt_p_convert_msg(type, conv), &info);
+            return getopt_p_option_unknown;
+        }
+    } else {
+        /* No argument expected */
+        arg_idx++;
+        if (arg[arg_idx] == '\0') {
+            state->optind++;    /* Finished this argv entry, move on */
+            arg_idx = 0;        /* Reset to look at start of next argv entry */
+        }
+    }
+    state->arg_idx = arg_idx;
+
+    /* Return the option character that we found */
+    return c;
+}
+
+
+static const getopt_p_long_index * getopt_p_long_global_index (
+    const getopt_p_option * longopts)
+{
+    if (longopts == NULL) {
+        return NULL;
+    }
+
+    /*
+     * Index the long options on first use, whenever a different table is
+     * given, and at the start of each parse, as the caller may have
+     * refilled the same array. A table whose end has moved is indexed
+     * again mid-parse too, which costs two compares per call to check.
+     */
+    getopt_p_long_index * index = &getopt_p_long_global;
+    int restart = (GETOPT_P_NAME(optind) <= 1 &&
+        getopt_p_global.arg_idx == 0) || GETOPT_P_NAME(optreset);
+    if (restart || index->longopts != longopts ||
+        longopts[index->count].name != NULL ||
+        (index->count > 0 && longopts[index->count - 1].name == NULL)) {
+        (void)getopt_p_long_compile(index, longopts);
+    }
+    return index;
+}
+
+
+static int getopt_p_long_next (getopt_p_state * state, int argc,
+    char * const argv[], const char * opt_str,
+    const getopt_p_long_index * index, int long_only, int * longindex)
+{
+    /*
+     * Long options are "--name", or "-name" for getopt_long_only(). As per
+     * GNU, "-c" is short if c is anywhere in the option string (even ':'),
+     * not only if it is an option character.
+     */
+    const char * arg = (state->arg_idx == 0 && state->optind < argc) ?
+        argv[state->optind] : NULL;
+    if (getopt_p_arg_kind(arg) == getopt_p_arg_option && (arg[1] == '-' ||
+        (long_only && (arg[2] != '\0' ||
+        strchr(opt_str, (int)arg[1]) == NULL)))) {
+        const char * name = (arg[1] == '-') ? &arg[2] : &arg[1];
+        size_t name_len;
+        unsigned long hash = getopt_p_long_hash(name, &name_len);
+        const unsigned short * candidates;
+        int candidates_len;
+        int found = getopt_p_long_find(index, name, name_len, hash,
+            long_only, &candidates, &candidates_len);
+
+        /* "-name" not matching a long option may be short options */
+        if (found != -1 || arg[1] == '-' ||
+            strchr(opt_str, (int)arg[1]) == NULL) {
+            return getopt_p_long_option(state, argc, argv, opt_str, index,
+                found, candidates, candidates_len, longindex);
+        }
+    }
+    return getopt_p_short_next(state, argc, argv, opt_str, NULL);
+}
+
+
+static int getopt_p_long_option (getopt_p_state * state, int argc,
+    char * const argv[], const char * opt_str,
+    const getopt_p_long_index * index, int found,
+    const unsigned short * candidates, int candidates_len, int * longindex)
+{
+    const char * arg = argv[state->optind];     /* Current argv entry */
+    const char * name = (arg[1] == '-') ? &arg[2] : &arg[1];
+    const char * equals = strchr(name, (int)'=');   /* "--name=arg" */
+    size_t name_len = (size_t)(name - arg) +    /* Length with the dashes */
+        ((equals != NULL) ? (size_t)(equals - name) : strlen(name));
+    int missing_colon = (opt_str[0] == ':' ||
+        (opt_str[0] == '-' && opt_str[1] == ':'));
+    getopt_p_error_info info;   /* Details of any error */
+
+    state->optarg = NULL;   /* Default to no (empty) argument to option */
+    state->err_kind = getopt_p_option_valid;
+    memset(&info, 0, sizeof(info));
+    info.argv_idx = state->optind;
+    info.long_name = arg;
+    info.long_len = (int)name_len;
+    info.longopts = index->longopts;
+
+    /* Unknown or ambiguous long options (as per GNU, optopt is zero) */
+    if (found < 0) {
+        state->optopt = 0;
+        state->err_kind = getopt_p_option_unknown;
+        if (found == -1) {
+            info.long_len = (int)strlen(arg);
+        } else {
+            info.candidates = candidates;
+            info.candidates_len = candidates_len;
+        }
+        getopt_p_print_err(state, argv, missing_colon, (found == -1) ?
+            "invalid option" : "ambiguous option", &info);
+        state->optind++;        /* Finished this argv entry, move on */
+        return getopt_p_option_unknown;
+    }
+
+    /* Check the argument against the has_arg of the long option */
+    const getopt_p_option * option = &index->longopts[found];
+    state->optopt = option->val;
+    if (equals != NULL) {
+        if (option->has_arg == GETOPT_P_NAME(no_argument)) {
+            state->err_kind = getopt_p_option_unknown;
+            getopt_p_print_err(state, argv, missing_colon,
+                "argument not allowed for option", &info);
+            state->optind++;    /* Finished this argv entry, move on */
+            return getopt_p_option_unknown;
+        }
+        state->optarg = equals + 1;
+    } else if (option->has_arg == GETOPT_P_NAME(required_argument)) {
+        if ((state->optind+1) < argc) {
+            /* Argument for this option is in the next argv */
+            state->optind++;    /* Advance to next argv to find the argument */
+            state->optarg = argv[state->optind];
+        } else {
+            state->err_kind = getopt_p_option_missing;
+            getopt_p_print_err(state, argv, missing_colon,
+                "argument required for option", &info);
+            state->optind++;    /* Finished this argv entry, move on */
+            if (missing_colon) {    /* POSIX compliant behaviour */
+                return getopt_p_option_missing;
+            } else {
+                return getopt_p_option_unknown;
+            }
+        }
+    }
+    state->optind++;            /* Finished this argv entry, move on */
+
+    /* Return the long option that we found */
+    if (longindex != NULL) {
+        *longindex = found;
+    }
+    if (option->flag != NULL) {
+        *option->flag = option->val;
+        return 0;
+    }
+    return option->val;
+}
+
+
+static int getopt_p_long_find (const getopt_p_long_index * index,
+    const char * name, size_t name_len, unsigned long hash, int long_only,
+    const unsigned short ** candidates, int * candidates_len)
+{
+    const getopt_p_option * longopts = index->longopts;
+    *candidates = NULL;
+    *candidates_len = 0;
+
+    /* An exact match is in the one slot the perfect hash gives */
+    if (index->hashed) {
+        unsigned bucket = (unsigned)hash & (index->slot_mask >> 1);
+        unsigned slot = getopt_p_long_slot(hash, index->disp[bucket],
+            index->slot_mask);
+        int i = (int)index->slot[slot] - 1;
+        if (i >= 0 && strncmp(longopts[i].name, name, name_len) == 0 &&
+            longopts[i].name[name_len] == '\0') {
+            return i;
+        }
+    }
+
+    /*
+     * Otherwise an abbreviation, unique unless the candidates are alike
+     * (as per GNU, getopt_long_only() counts any two as ambiguous). The
+     * candidates are a range of the names sorted by getopt_p_long_compile().
+     */
+    if (index->count <= GETOPT_P_LONG_MAX) {
+        const unsigned short * sorted = index->sorted;
+        int lo = 0;
+        int hi = index->count;
+        while (lo < hi) {       /* First name not before the abbreviation */
+            int mid = lo + (hi - lo) / 2;
+            if (strncmp(longopts[sorted[mid]].name, name, name_len) < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        int first = lo;         /* First candidate */
+        hi = index->count;
+        while (lo < hi) {       /* First name after the abbreviation */
+            int mid = lo + (hi - lo) / 2;
+            if (strncmp(longopts[sorted[mid]].name, name, name_len) > 0) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        if (first == lo) {
+            return (int)-1;
+        }
+        if (longopts[sorted[first]].name[name_len] == '\0') {
+            return (int)sorted[first];  /* Exact match, if not hashed */
+        }
+
+        int found = (int)sorted[first];
+        int ambiguous = 0;
+        for (int i = first + 1; i < lo; i++) {
+            int j = (int)sorted[i];
+            if (long_only || longopts[j].has_arg != longopts[found].has_arg ||
+                longopts[j].flag != longopts[found].flag ||
+                longopts[j].val != longopts[found].val) {
+                ambiguous = 1;
+            }
+            found = (j < found) ? j : found;    /* First in the table */
+        }
+        if (ambiguous) {
+            *candidates = &sorted[first];
+            *candidates_len = lo - first;
+            return (int)-2;
+        }
+        return found;
+    }
+
+    /* Tables too large to index are searched linearly */
+    int found = (int)-1;
+    int ambiguous = 0;
+    for (int i = 0; i < index->count; i++) {
+        if (strncmp(longopts[i].name, name, name_len) != 0) {
+            continue;
+        }
+        if (longopts[i].name[name_len] == '\0') {
+            return i;
+        }
+        if (found == -1) {
+            found = i;
+        } else if (long_only ||
+            longopts[i].has_arg != longopts[found].has_arg ||
+            longopts[i].flag != longopts[found].flag ||
+            longopts[i].val != longopts[found].val) {
+            ambiguous = 1;
+        }
+    }
+    return ambiguous ? (int)-2 : found;
+}
+
+
+static int getopt_p_long_order (const getopt_p_option * longopts, int a,
+    int b)
+{
+    /* Order by name, then by position for repeated names */
+    int order = strcmp(longopts[a].name, longopts[b].name);
+    return (order != 0) ? order : (a - b);
+}
+
+
+static unsigned long getopt_p_long_hash (const char * name,
+    size_t * name_len)
+{
+    /* 32 bit FNV-1a hash of the name, up to any "=arg" */
+    unsigned long hash = 2166136261UL;
+    size_t len = 0;
+    while (name[len] != '\0' && name[len] != '=') {
+        hash = ((hash ^ (unsigned char)name[len]) * 16777619UL) &
+            0xFFFFFFFFUL;
+        len++;
+    }
+    *name_len = len;
+    return hash;
+}
+
+
+static unsigned getopt_p_long_slot (unsigned long hash, unsigned disp,
+    unsigned slot_mask)
+{
+    /* Mix the bucket displacement in to the hash (murmur3 finaliser) */
+    unsigned long h = (hash ^ (disp * 0x9E3779B9UL)) & 0xFFFFFFFFUL;
+    h ^= h >> 16;
+    h = (h * 0x85EBCA6BUL) & 0xFFFFFFFFUL;
+    h ^= h >> 13;
+    h = (h * 0xC2B2AE35UL) & 0xFFFFFFFFUL;
+    h ^= h >> 16;
+    return (unsigned)h & slot_mask;
+}
+
+
+static int getopt_p_classify (const char * opt_str, int option_char)
+{
+    if (opt_str[0] == '-') {
+        opt_str++;          /* '-' is a flag, not an option character */
+    }
+
+    /* Check if the option character is one that was specified */
+    const char * cp = strchr(opt_str, option_char); /* Ptr to option */
+    if (option_char == ':' || cp == NULL) {
+        return getopt_p_class_unknown;
+    }
+
+    /* Check if this option is specified to take an argument */
+    if (*(cp+1) != ':') {
+        return getopt_p_class_flag;
+    }
+    if (*(cp+2) == ':') {
+        return getopt_p_class_optional;     /* Extension : '::' */
+    }
+    return getopt_p_class_arg;
+}
+
+
+static int getopt_p_arg_kind (const char * arg)
+{
+    /* Classify by the first bytes, rather than comparing strings */
+    if (arg == NULL || arg[0] != '-') {
+        return getopt_p_arg_operand;
+    }
+    if (arg[1] == '\0') {
+        return getopt_p_arg_dash;
+    }
+    if (arg[1] == '-' && arg[2] == '\0') {
+        return getopt_p_arg_dashdash;
+    }
+    return getopt_p_arg_option;
+}
+
+
+static int getopt_p_parse_u64 (const char * arg, size_t len, uint64_t limit,
+    uint64_t * value)
+{
+    /*
+     * Digits are converted eight at a time (SWAR) while at least eight
+     * remain, then one at a time; the length is found first so that no
+     * read goes past the end. Out of range numbers are still read to the
+     * end so that trailing junk is reported as a syntax error.
+     */
+    const uint64_t ones = 0x0101010101010101ULL;
+    size_t idx = 0;
+    uint64_t number = 0;
+    int overflow = 0;
+    if (len > 2 && arg[0] == '0' && (arg[1] | 0x20) == 'x') {
+        /* Hex : eight digits make 32 bits */
+        for (idx = 2; idx + 8 <= len; idx += 8) {
+            uint64_t bytes = getopt_p_load8(&arg[idx]);
+            uint64_t lower = bytes | (ones * 0x20);     /* Only for a-f */
+            uint64_t digit = getopt_p_swar_between(bytes, '0' - 1, '9' + 1);
+            uint64_t alpha = getopt_p_swar_between(lower, 'a' - 1, 'f' + 1);
+            if ((bytes & (ones * 0x80)) != 0 ||
+                (digit | alpha) != ones * 0x80) {
+                return getopt_p_convert_syntax;
+            }
+            uint64_t nibbles = (lower & (ones * 0x0f)) + (alpha >> 7) * 9;
+            uint64_t pairs = ((nibbles & 0x000f000f000f000fULL) << 4) |
+                ((nibbles & 0x0f000f000f000f00ULL) >> 8);
+            uint64_t quads = ((pairs & 0x000000ff000000ffULL) << 8) |
+                ((pairs & 0x00ff000000ff0000ULL) >> 16);
+            uint64_t word = ((quads & 0xffffULL) << 16) |
+                ((quads >> 32) & 0xffffULL);
+            if (number > (limit >> 32) || ((number << 32) | word) > limit) {
+                overflow = 1;
+            } else {
+                number = (number << 32) | word;
+            }
+        }
+        for (; idx < len; idx++) {
+            int lower = arg[idx] | 0x20;
+            uint64_t nibble = (arg[idx] >= '0' && arg[idx] <= '9') ?
+                (uint64_t)(arg[idx] - '0') : (lower >= 'a' && lower <= 'f') ?
+                (uint64_t)(lower - 'a' + 10) : 16;
+            if (nibble > 15) {
+                return getopt_p_convert_syntax;
+            }
+            if (number > (limit >> 4) || ((number << 4) | nibble) > limit) {
+                overflow = 1;
+            } else {
+                number = (number << 4) | nibble;
+            }
+        }
+    } else {
+        /* Decimal : eight digits make a number below 10^8 */
+        if (len == 0) {
+            return getopt_p_convert_syntax;
+        }
+        for (; idx + 8 <= len; idx += 8) {
+            uint64_t bytes = getopt_p_load8(&arg[idx]);
+            if (((bytes & (ones * 0xf0)) |
+                (((bytes + ones * 0x06) & (ones * 0xf0)) >> 4)) !=
+                ones * 0x33) {
+                return getopt_p_convert_syntax;
+            }
+            bytes -= ones * '0';
+            bytes = (bytes * 10) + (bytes >> 8);
+            uint64_t word = (((bytes & 0x000000ff000000ffULL) *
+                (100 + (1000000ULL << 32))) +
+                (((bytes >> 16) & 0x000000ff000000ffULL) *
+                (1 + (10000ULL << 32)))) >> 32;
+            uint64_t scaled = number * 100000000ULL;
+            if (number > UINT64_MAX / 100000000ULL ||
+                scaled > UINT64_MAX - word || scaled + word > limit) {
+                overflow = 1;
+            } else {
+                number = scaled + word;
+            }
+        }
+        for (; idx < len; idx++) {
+            uint64_t digit = (uint64_t)(unsigned char)arg[idx] - '0';
+            if (digit > 9) {
+                return getopt_p_convert_syntax;
+            }
+            uint64_t scaled = number * 10;
+            if (number > UINT64_MAX / 10 || scaled > UINT64_MAX - digit ||
+                scaled + digit > limit) {
+                overflow = 1;
+            } else {
+                number = scaled + digit;
+            }
+        }
+    }
+    if (overflow) {
+        return getopt_p_convert_range;
+    }
+    *value = number;
+    return getopt_p_convert_ok;
+}
+
+
+static int getopt_p_parse_unit (int type, const char * arg,
+    uint64_t * value)
+{
+    /*
+     * Units are at most three characters, packed in to a key compared with
+     * every entry of the table for the type, so there is one loop and no
+     * string comparisons. Each entry has the largest number it can scale.
+     */
+    static const struct {
+        unsigned long key;  /* Unit characters, first in the low byte */
+        uint64_t scale;     /* Bytes or nanoseconds per unit */
+        uint64_t max;       /* Largest number which does not overflow */
+    } units[] = {
+#define GETOPT_P_UNIT(a, b, c, scale) { (unsigned long)(a) | \
+    ((unsigned long)(b) << 8) | ((unsigned long)(c) << 16), (scale), \
+    UINT64_MAX / (scale) }
+        /* Sizes : K is 1024 as for dd, KB is SI 1000, KiB is IEC 1024 */
+        GETOPT_P_UNIT(0, 0, 0, 1ULL),
+        GETOPT_P_UNIT('B', 0, 0, 1ULL),
+        GETOPT_P_UNIT('K', 0, 0, 1ULL << 10),
+        GETOPT_P_UNIT('k', 0, 0, 1ULL << 10),
+        GETOPT_P_UNIT('K', 'B', 0, 1000ULL),
+        GETOPT_P_UNIT('k', 'B', 0, 1000ULL),
+        GETOPT_P_UNIT('K', 'i', 'B', 1ULL << 10),
+        GETOPT_P_UNIT('M', 0, 0, 1ULL << 20),
+        GETOPT_P_UNIT('M', 'B', 0, 1000000ULL),
+        GETOPT_P_UNIT('M', 'i', 'B', 1ULL << 20),
+        GETOPT_P_UNIT('G', 0, 0, 1ULL << 30),
+        GETOPT_P_UNIT('G', 'B', 0, 1000000000ULL),
+        GETOPT_P_UNIT('G', 'i', 'B', 1ULL << 30),
+        GETOPT_P_UNIT('T', 0, 0, 1ULL << 40),
+        GETOPT_P_UNIT('T', 'B', 0, 1000000000000ULL),
+        GETOPT_P_UNIT('T', 'i', 'B', 1ULL << 40),
+        /* Durations : a number without a unit is in seconds */
+        GETOPT_P_UNIT(0, 0, 0, 1000000000ULL),
+        GETOPT_P_UNIT('n', 's', 0, 1ULL),
+        GETOPT_P_UNIT('u', 's', 0, 1000ULL),
+        GETOPT_P_UNIT('m', 's', 0, 1000000ULL),
+        GETOPT_P_UNIT('s', 0, 0, 1000000000ULL),
+        GETOPT_P_UNIT('m', 0, 0, 60000000000ULL),
+        GETOPT_P_UNIT('h', 0, 0, 3600000000000ULL)
+#undef GETOPT_P_UNIT
+    };
+    enum { sizes = 16 };    /* Size units come first, then durations */
+
+    /* The number is every leading digit, the unit is what follows */
+    size_t len = 0;
+    while (arg[len] >= '0' && arg[len] <= '9') {
+        len++;
+    }
+    if (len == 0) {
+        return getopt_p_convert_syntax;
+    }
+    const char * unit = &arg[len];
+    unsigned long key = 0;
+    for (int k = 0; k < 4 && (k == 0 || unit[k-1] != '\0'); k++) {
+        key |= (unsigned long)(unsigned char)unit[k] << (8*k);
+    }
+    if ((key >> 24) != 0) {
+        return getopt_p_convert_unit;   /* Longer than any unit */
+    }
+
+    int first = (type == getopt_p_type_size) ? 0 : sizes;
+    int last = (type == getopt_p_type_size) ? sizes :
+        (int)(sizeof(units) / sizeof(units[0]));
+    for (int i = first; i < last; i++) {
+        if (units[i].key == key) {
+            uint64_t number;
+            int conv = getopt_p_parse_u64(arg, len, units[i].max, &number);
+            if (conv == getopt_p_convert_ok) {
+                *value = number * units[i].scale;
+            }
+            return conv;
+        }
+    }
+    return getopt_p_convert_unit;
+}
+
+
+static uint64_t getopt_p_load8 (const char * str)
+{
+    /* First character in the low byte, whatever the byte order */
+    uint64_t bytes = 0;
+    for (int k = 0; k < 8; k++) {
+        bytes |= (uint64_t)(unsigned char)str[k] << (8*k);
+    }
+    return bytes;
+}
+
+
+static uint64_t getopt_p_swar_between (uint64_t bytes, int low, int high)
+{
+    /* Set the high bit of each byte with low < byte < high (bytes < 128) */
+    const uint64_t ones = 0x0101010101010101ULL;
+    uint64_t low7 = bytes & (ones * 0x7f);
+    return ((ones * (uint64_t)(127 + high)) - low7) & ~bytes &
+        (low7 + ones * (uint64_t)(127 - low)) & (ones * 0x80);
+}
+
+
+static const char * getopt_p_convert_msg (int type, int conv)
+{
+    if (conv == getopt_p_convert_range) {
+        return "number out of range for option";
+    }
+    if (conv == getopt_p_convert_unit) {
+        return (type == getopt_p_type_size) ? "invalid size unit for option" :
+            "invalid duration unit for option";
+    }
+    return (type == getopt_p_type_bool) ? "invalid boolean for option" :
+        "invalid number for option";
+}
+
+
+static unsigned getopt_p_swar_match (unsigned long long bytes, int c)
+{
+    /* Set the high bit of each byte equal to c, without carries between */
+    const unsigned long long low7 = 0x7f7f7f7f7f7f7f7fULL;
+    unsigned long long diff = bytes ^
+        (0x0101010101010101ULL * (unsigned char)c);
+    unsigned long long zero = ~(((diff & low7) + low7) | diff | low7);
+
+    /* Gather the high bit of byte k in to bit k */
+    return (unsigned)(((zero >> 7) * 0x0102040810204080ULL) >> 56);
+}
+
+
+static int getopt_p_ctz (unsigned long long word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else /* #if defined(__GNUC__) || defined(__clang__) */
+    int count = 0;
+    while ((word & 0xffu) == 0) {
+        word >>= 8;
+        count += 8;
+    }
+    while ((word & 1u) == 0) {
+        word >>= 1;
+        count++;
+    }
+    return count;
+#endif /* #if defined(__GNUC__) || defined(__clang__) */
+}
+
+
+static int getopt_p_rsp_arg (getopt_p_rsp * rsp, char * arg, int depth,
+    char * rsp_argv[], int rsp_argv_max, int len)
+{
+    /* Ordinary arguments are copied by pointer */
+    if (arg[0] != '@' || arg[1] == '\0') {
+        if (len >= rsp_argv_max) {
+            return (int)-1;     /* Out of space in rsp_argv */
+        }
+        rsp_argv[len++] = arg;
+        return len;
+    }
+
+    /* Expand the response file, including any response files it names */
+    if (depth >= rsp->depth_max) {
+        return (int)-1;         /* Response files nested too deeply */
+    }
+    char * text;            /* Private copy of the response file */
+    size_t size;            /* Size of the response file */
+    if (getopt_p_rsp_map_file(rsp, &arg[1], &text, &size) != 0) {
+        return (int)-1;
+    }
+    char * pos = text;      /* Position of the next token in text */
+    char * token;
+    while (len >= 0 && (token = getopt_p_token(&pos, text + size)) != NULL) {
+        len = getopt_p_rsp_arg(rsp, token, depth + 1, rsp_argv, rsp_argv_max,
+            len);
+    }
+    return len;
+}
+
+
+static int getopt_p_rsp_map_file (getopt_p_rsp * rsp, const char * path,
+    char ** text, size_t * size)
+{
+    if (rsp->maps_len >= rsp->maps_max) {
+        return (int)-1;         /* Out of space to record the mapping */
+    }
+
+    /*
+     * The file is mapped copy-on-write so that tokens can be terminated
+     * in place. The zero filled tail of the last page holds the '\0' of
+     * the last token. A file which exactly fills its pages has no such
+     * tail, so it is read in to an anonymous mapping one byte larger.
+     */
+    void * base = NULL;     /* Start of the mapping */
+    size_t map_size = 0;    /* Size of the mapping */
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER file_size;
+    SYSTEM_INFO info;
+    if (file == INVALID_HANDLE_VALUE) {
+        return (int)-1;
+    }
+    if (!GetFileSizeEx(file, &file_size) ||
+        (unsigned long long)file_size.QuadPart >= (size_t)-1) {
+        (void)CloseHandle(file);
+        return (int)-1;
+    }
+    *size = (size_t)file_size.QuadPart;
+    GetSystemInfo(&info);
+    if (*size > 0 && (*size % info.dwPageSize) != 0) {
+        map_size = *size;
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0,
+            NULL);
+        if (mapping != NULL) {
+            base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+            (void)CloseHandle(mapping);     /* The view keeps it open */
+        }
+    } else if (*size > 0) {
+        map_size = *size + 1;
+        unsigned long long map_size64 = (unsigned long long)map_size;
+        HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL,
+            PAGE_READWRITE, (DWORD)(map_size64 >> 32), (DWORD)map_size64,
+            NULL);
+        if (mapping != NULL) {
+            base = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+            (void)CloseHandle(mapping);     /* The view keeps it open */
+        }
+        for (size_t done = 0; base != NULL && done < *size; ) {
+            DWORD chunk = (*size - done > 0x40000000) ? 0x40000000 :
+                (DWORD)(*size - done);
+            DWORD got = 0;
+            if (!ReadFile(file, (char *)base + done, chunk, &got, NULL) ||
+                got == 0) {
+                (void)UnmapViewOfFile(base);
+                base = NULL;
+            }
+            done += got;
+        }
+    }
+    (void)CloseHandle(file);
+#else /* #ifdef _WIN32 */
+    int fd = open(path, O_RDONLY);
+    struct stat file_stat;
+    if (fd < 0) {
+        return (int)-1;
+    }
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < 0 ||
+        (unsigned long long)file_stat.st_size >= (size_t)-1) {
+        (void)close(fd);
+        return (int)-1;
+    }
+    *size = (size_t)file_stat.st_size;
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    if (*size > 0 && (*size % page_size) != 0) {
+        map_size = *size;
+        base = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+            0);
+    } else if (*size > 0) {
+        map_size = *size + 1;
+#ifdef MAP_ANONYMOUS
+        base = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#else /* #ifdef MAP_ANONYMOUS */
+        int zero_fd = open("/dev/zero", O_RDWR);
+        base = (zero_fd < 0) ? MAP_FAILED : mmap(NULL, map_size,
+            PROT_READ | PROT_WRITE, MAP_PRIVATE, zero_fd, 0);
+        if (zero_fd >= 0) {
+            (void)close(zero_fd);
+        }
+#endif /* #ifdef MAP_ANONYMOUS */
+        for (size_t done = 0; base != MAP_FAILED && done < *size; ) {
+            ssize_t got = read(fd, (char *)base + done, *size - done);
+            if (got <= 0) {
+                (void)munmap(base, map_size);
+                base = MAP_FAILED;
+            } else {
+                done += (size_t)got;
+            }
+        }
+    }
+    if (base == MAP_FAILED) {
+        base = NULL;
+    }
+    (void)close(fd);
+#endif /* #ifdef _WIN32 */
+
+    /* An empty file has no tokens, so needs no mapping */
+    if (*size == 0) {
+        *text = NULL;
+        return 0;
+    }
+    if (base == NULL) {
+        return (int)-1;
+    }
+    rsp->maps[rsp->maps_len].base = base;
+    rsp->maps[rsp->maps_len].size = map_size;
+    rsp->maps_len++;
+    *text = (char *)base;
+    return 0;
+}
+
+
+static char * getopt_p_token (char ** pos, char * end)
+{
+    /*
+     * Tokens are separated by whitespace. Within a token '...' quotes
+     * everything, "..." quotes all but '\"' and '\\', and outside quotes
+     * '\' escapes a following quote, '\' or whitespace. Tokens are copied
+     * down in place and '\0' terminated; end[0] must be writable.
+     */
+    char * src = *pos;      /* Next character to read */
+    while (src < end && (*src == ' ' || (*src >= '\t' && *src <= '\r'))) {
+        src++;
+    }
+    if (src >= end) {
+        *pos = end;
+        return NULL;        /* No more tokens */
+    }
+
+    char * token = src;     /* Start of the token */
+    char * dst = src;       /* Next character to write */
+    char quote = '\0';      /* Quote character while within quotes */
+    while (src < end) {
+        char ch = *src;
+        if (quote != '\0') {
+            if (ch == quote) {
+                quote = '\0';
+                src++;
+                continue;
+            }
+            if (ch == '\\' && quote == '"' && (src+1) < end &&
+                (src[1] == '"' || src[1] == '\\')) {
+                ch = *++src;
+            }
+        } else {
+            if (ch == ' ' || (ch >= '\t' && ch <= '\r')) {
+                break;      /* End of the token */
+            }
+            if (ch == '\'' || ch == '"') {
+                quote = ch;
+                src++;
+                continue;
+            }
+            if (ch == '\\' && (src+1) < end && (src[1] == '\'' ||
+                src[1] == '"' || src[1] == '\\' || src[1] == ' ' ||
+                (src[1] >= '\t' && src[1] <= '\r'))) {
+                ch = *++src;
+            }
+        }
+        *dst++ = ch;
+        src++;
+    }
+    *pos = (src < end) ? (src + 1) : end;  /* Skip the separator */
+    *dst = '\0';
+    return token;
+}
+
+
+static int getopt_p_stream_fill (getopt_p_stream * stream, size_t offset,
+    size_t * len)
+{
+    /*
+     * Make sure a whole argument starting offset bytes after head is in
+     * the buffer, '\0' terminated in place. An argument straddling the
+     * end of the buffer is moved down to the start (along with anything
+     * before it from head) and the rest of it read after it.
+     */
+    for (;;) {
+        char * start = stream->buf + stream->head + offset;
+        if (stream->head + offset < stream->split) {
+            *len = strlen(start);   /* Already split */
+            return 1;
+        }
+        char * end = stream->buf + stream->tail;
+        char * delim = (char *)memchr(start, stream->delim,
+            (size_t)(end - start));
+        if (delim == NULL && stream->end_of_file && start < end &&
+            stream->tail < stream->buf_size) {
+            delim = end;        /* Last argument has no delimiter */
+            stream->tail++;
+        }
+        if (delim != NULL) {
+            *delim = '\0';
+            stream->split = (size_t)(delim - stream->buf) + 1;
+            *len = (size_t)(delim - start);
+            return 1;
+        }
+        if (stream->end_of_file && start >= end) {
+            return 0;           /* No more arguments */
+        }
+
+        /* Move the unparsed bytes down, then read more after them */
+        if (stream->head > 0) {
+            size_t kept = stream->tail - stream->head;
+            (void)memmove(stream->buf, stream->buf + stream->head, kept);
+            stream->split -= (stream->split > stream->head) ?
+                stream->head : stream->split;
+            stream->tail = kept;
+            stream->head = 0;
+        }
+        if (stream->tail >= stream->buf_size) {
+            stream->error = 1;  /* Argument longer than the buffer */
+            return (int)-1;
+        }
+        if (stream->end_of_file) {
+            continue;           /* Room for the final '\0' now */
+        }
+#ifdef _WIN32
+        size_t want = stream->buf_size - stream->tail;
+        int got = _read(stream->fd, stream->buf + stream->tail,
+            (want > 0x40000000) ? 0x40000000u : (unsigned)want);
+#else /* #ifdef _WIN32 */
+        ssize_t got = read(stream->fd, stream->buf + stream->tail,
+            stream->buf_size - stream->tail);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+#endif /* #ifdef _WIN32 */
+        if (got < 0) {
+            stream->error = 1;
+            return (int)-1;
+        }
+        if (got == 0) {
+            stream->end_of_file = 1;
+        }
+        stream->tail += (size_t)got;
+    }
+}
+
+
+static void getopt_p_stream_err (const getopt_p_error_info * info,
+    void * context)
+{
+    /* Entry 1 of the argv window is the argument at next_index */
+    const getopt_p_stream_err_ctx * err_ctx =
+        (const getopt_p_stream_err_ctx *)context;
+    getopt_p_error_info stream_info = *info;
+    stream_info.argv_idx = (int)(err_ctx->stream->next_index +
+        (long long)(info->argv_idx - 1));
+    err_ctx->err_fn(&stream_info, err_ctx->err_context);
+    return;
+}
+
+
+static void getopt_p_print_err (const getopt_p_state * state,
+    char * const argv[], int missing_colon, const char * msg,
+    getopt_p_error_info * info)
+{
+    /* Report the error, based on runtime configuration */
+    if (!state->opterr || missing_colon) {
+        return;
+    }
+    info->err_kind = state->err_kind;
+    info->prog_name = getopt_p_prog_name(argv);
+    if (state->err_fn != NULL) {
+        /* Pass the error to the handler, which formats it if it wants to */
+        state->err_fn(info, state->err_context);
+        return;
+    }
+
+    /* Format "<name> : <msg> '-<c>'" in to a buffer on the stack */
+    char buf[512];          /* Room for a long program name and message */
+    char option[] = { '-', (char)info->option, '\0' };
+    const char * quoted = (info->long_name != NULL) ? info->long_name : option;
+    size_t quoted_len = (info->long_name != NULL) ? (size_t)info->long_len : 2;
+    size_t len = 0;
+    len = getopt_p_append(buf, len, 128, info->prog_name);
+    len = getopt_p_append(buf, len, sizeof(buf), " : ");
+    len = getopt_p_append(buf, len, 192, msg);
+    size_t size = sizeof(buf) - 2;  /* Keep room for "'\n" */
+    len = getopt_p_append(buf, len, size, " '");
+    len = getopt_p_append(buf, len, (len + quoted_len + 1 < size) ?
+        (len + quoted_len + 1) : size, quoted);
+
+    /* List the candidates of an ambiguous long option, as far as they fit */
+    for (int i = 0; i < info->candidates_len; i++) {
+        const char * dashes = (quoted[1] == '-') ? "--" : "-";
+        len = getopt_p_append(buf, len, size, (i == 0) ? "', could be '" :
+            "' '");
+        len = getopt_p_append(buf, len, size, dashes);
+        len = getopt_p_append(buf, len, size,
+            info->longopts[info->candidates[i]].name);
+    }
+
+    /* Quote an argument which failed to convert */
+    if (info->optarg != NULL) {
+        len = getopt_p_append(buf, len, size, "' : '");
+        len = getopt_p_append(buf, len, size, info->optarg);
+    }
+    len = getopt_p_append(buf, len, sizeof(buf), "'\n");
+
+    /* Now report the error, with a single unbuffered write */
+#ifdef _WIN32
+    (void)_write(2, buf, (unsigned)len);
+#else /* #ifdef _WIN32 */
+    ssize_t written = write(2, buf, len);
+    (void)written;
+#endif /* #ifdef _WIN32 */
+    return;
+}
+
+
+static const char * getopt_p_prog_name (char * const argv[])
+{
+#ifdef _WIN32
+    /* Basename of the program path, found at the first error and kept */
+    static void * volatile name_cache = NULL;
+    void * name = InterlockedCompareExchangePointer(&name_cache, NULL, NULL);
+    if (name != NULL) {
+        return (const char *)name;
+    }
+    char * name_ptr;    /* Pointer rather than buffer is OK */
+    if (_get_pgmptr(&name_ptr) == 0 && name_ptr != NULL) {
+        const char * short_name = strrchr(name_ptr, (int)'\\');
+        name = (short_name != NULL) ? (void *)(short_name+1) : name_ptr;
+        /* Racing threads all find the same name, so the first one wins */
+        (void)InterlockedCompareExchangePointer(&name_cache, name, NULL);
+        return (const char *)name;
+    }
+#endif /* #ifdef _WIN32 */
+
+    /* Otherwise the basename of argv[0], which may differ between calls */
+    if (argv != NULL && argv[0] != NULL && argv[0][0] != '\0') {
+        const char * short_name = strrchr(argv[0], (int)'/');
+#ifdef _WIN32
+        const char * back_slash = strrchr(argv[0], (int)'\\');
+        if (back_slash != NULL && (short_name == NULL ||
+            back_slash > short_name)) {
+            short_name = back_slash;
+        }
+#endif /* #ifdef _WIN32 */
+        return (short_name != NULL) ? (short_name+1) : argv[0];
+    }
+    return "Error";
+}
+
+
+static size_t getopt_p_append (char * buf, size_t len, size_t size,
+    const char * str)
+{
+    /* Append as much of str as fits before size, keeping a terminator */
+    while (*str != '\0' && (len + 1) < size) {
+        buf[len++] = *str++;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* #if defined(_WIN32) || defined(GETOPT_P_FORCE_PORTABLE) */
 
 #endif /* #ifdef GETOPT_P_IMPLEMENTATION */
 
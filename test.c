@@ -0,0 +1,378 @@
+/*
+test.c
+Checks of the "getop_p.h" error reporting and argument conversion.
+SPDX-License-Identifier: Unlicense OR 0BSD
+
+The portable implementation is built with GETOPT_P_FORCE_PORTABLE, so the
+checks run on any platform. The program prints each failed check and
+exits non-zero if any fail :
+
+    cc -o test test.c && ./test
+*/
+
+#define _POSIX_C_SOURCE 200809L     /* fileno() from <stdio.h> */
+#define GETOPT_P_FORCE_PORTABLE
+#define GETOPT_P_IMPLEMENTATION
+#include "getopt_p.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Last error passed to test_on_error() */
+typedef struct test_error {
+    int calls;              /* Number of errors reported */
+    int err_kind;           /* getopt_p_error kind of the last error */
+    int argv_idx;           /* Index reported for the last error */
+    const char * prog_name; /* Program name of the last error */
+} test_error;
+
+void test_on_error (const getopt_p_error_info * info, void * context);
+void test_argv_idx (const char * name, char * argv[], int err_kind,
+    int argv_idx);
+void test_long_argv_idx (void);
+void test_stream_argv_idx (void);
+void test_prog_name (void);
+void test_convert (void);
+void test_permute_records (void);
+void test_long_refill (void);
+
+static int test_failures = 0;
+
+#define TEST_CHECK(cond, name) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s : %s\n", (name), #cond); \
+            test_failures++; \
+        } \
+    } while (0)
+
+int main (void)
+{
+    /* The entry with the option, not where optind has moved on to */
+    char * invalid[] = { "prog", "-a", "-j", "abc", "-b", NULL };
+    char * embedded[] = { "prog", "-jxyz", NULL };
+    char * last[] = { "prog", "-a", "-j", "abc", NULL };
+    char * unknown[] = { "prog", "-a", "-z", "-b", NULL };
+    char * missing[] = { "prog", "-a", "-j", NULL };
+    char * grouped[] = { "prog", "-ab", "-azb", NULL };
+    test_argv_idx("invalid separate", invalid, getopt_p_option_invalid, 2);
+    test_argv_idx("invalid embedded", embedded, getopt_p_option_invalid, 1);
+    test_argv_idx("invalid last", last, getopt_p_option_invalid, 2);
+    test_argv_idx("unknown", unknown, getopt_p_option_unknown, 2);
+    test_argv_idx("missing", missing, getopt_p_option_missing, 2);
+    test_argv_idx("unknown grouped", grouped, getopt_p_option_unknown, 2);
+    test_long_argv_idx();
+    test_stream_argv_idx();
+    test_prog_name();
+    test_convert();
+    test_permute_records();
+    test_long_refill();
+
+    if (test_failures != 0) {
+        printf("%d checks failed\n", test_failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
+
+void test_on_error (const getopt_p_error_info * info, void * context)
+{
+    test_error * error = (test_error *)context;
+    error->calls++;
+    error->err_kind = info->err_kind;
+    error->argv_idx = info->argv_idx;
+    error->prog_name = info->prog_name;
+    return;
+}
+
+/* Parse argv with "abj:" (-j an int32), checking the one error reported */
+void test_argv_idx (const char * name, char * argv[], int err_kind,
+    int argv_idx)
+{
+    getopt_p_table table;
+    getopt_p_compile(&table, "abj:");
+    getopt_p_set_type(&table, 'j', getopt_p_type_int32);
+    int argc = 0;
+    while (argv[argc] != NULL) {
+        argc++;
+    }
+
+    test_error error = { 0, 0, 0, NULL };
+    getopt_p_state state = GETOPT_P_STATE_INIT;
+    state.err_fn = test_on_error;
+    state.err_context = &error;
+    while (getopt_compiled_r(&state, argc, argv, &table) != -1) {
+    }
+    TEST_CHECK(error.calls == 1, name);
+    TEST_CHECK(error.err_kind == err_kind, name);
+    TEST_CHECK(error.argv_idx == argv_idx, name);
+    return;
+}
+
+void test_long_argv_idx (void)
+{
+    static const getopt_p_option longopts[] = {
+        { "file", GETOPT_P_NAME(required_argument), NULL, 'f' },
+        { "verbose", GETOPT_P_NAME(no_argument), NULL, 'v' },
+        { NULL, 0, NULL, 0 }
+    };
+    static getopt_p_long_index index;
+    getopt_p_long_compile(&index, longopts);
+    char * argv[] = { "prog", "--verbose", "--verbose=1", "--file", NULL };
+    int expected[] = { 2, 3 };
+
+    test_error error = { 0, 0, 0, NULL };
+    getopt_p_state state = GETOPT_P_STATE_INIT;
+    state.err_fn = test_on_error;
+    state.err_context = &error;
+    int errors = 0;
+    int c;
+    while ((c = getopt_long_r(&state, 4, argv, "", &index, NULL)) != -1) {
+        if (c == '?' && errors < 2) {
+            TEST_CHECK(error.argv_idx == expected[errors], "long");
+            errors++;
+        }
+    }
+    TEST_CHECK(errors == 2, "long");
+    return;
+}
+
+/* Errors in a stream are reported with their index in the stream */
+void test_stream_argv_idx (void)
+{
+    static const char text[] = "a\0b\0c\0-x\0-j\0abc\0-bj\0";
+    FILE * file = tmpfile();
+    if (file == NULL) {
+        TEST_CHECK(file != NULL, "stream");
+        return;
+    }
+    (void)fwrite(text, 1, sizeof(text) - 1, file);
+    (void)fflush(file);
+#ifdef _WIN32
+    int fd = _fileno(file);
+    (void)_lseek(fd, 0, SEEK_SET);
+#else /* #ifdef _WIN32 */
+    int fd = fileno(file);
+    (void)lseek(fd, 0, SEEK_SET);
+#endif /* #ifdef _WIN32 */
+
+    getopt_p_table table;
+    getopt_p_compile(&table, "abj:");
+    getopt_p_set_type(&table, 'j', getopt_p_type_int32);
+    char buf[64];
+    getopt_p_stream stream;
+    getopt_p_stream_init(&stream, fd, '\0', buf, sizeof(buf), &table,
+        "prog");
+    test_error error = { 0, 0, 0, NULL };
+    stream.state.err_fn = test_on_error;
+    stream.state.err_context = &error;
+    int expected[] = { 3, 4, 6 };   /* "-x", "-j abc" and "-bj" */
+    int errors = 0;
+    int c;
+    while ((c = getopt_p_stream_next(&stream)) != -1) {
+        if (c == '?' && errors < 3) {
+            TEST_CHECK(error.argv_idx == expected[errors], "stream");
+            TEST_CHECK(error.argv_idx == (int)stream.index, "stream");
+            errors++;
+        }
+    }
+    TEST_CHECK(errors == 3, "stream");
+    TEST_CHECK(stream.state.err_fn == test_on_error, "stream");
+    (void)fclose(file);
+    return;
+}
+
+/* The program name follows argv[0], even a buffer reused for another */
+void test_prog_name (void)
+{
+#ifndef _WIN32  /* Windows names the program from _get_pgmptr() */
+    char first[] = "/usr/local/bin/first";
+    char second[] = "second";
+    char reused[32];
+    char * paths[] = { first, first, second, first, reused, reused };
+    const char * sources[] = { NULL, NULL, NULL, NULL, "/usr/bin/first",
+        "tool" };
+    const char * expected[] = { "first", "first", "second", "first",
+        "first", "tool" };
+    for (int i = 0; i < 6; i++) {
+        if (sources[i] != NULL) {
+            strcpy(reused, sources[i]);
+        }
+        char * argv[] = { paths[i], "-z", NULL };
+        test_error error = { 0, 0, 0, NULL };
+        getopt_p_state state = GETOPT_P_STATE_INIT;
+        state.err_fn = test_on_error;
+        state.err_context = &error;
+        while (getopt_r(&state, 2, argv, "a") != -1) {
+        }
+        TEST_CHECK(error.prog_name != NULL &&
+            strcmp(error.prog_name, expected[i]) == 0, "prog name");
+        TEST_CHECK(error.prog_name >= paths[i] &&
+            error.prog_name < paths[i] + strlen(paths[i]), "prog name");
+    }
+#endif /* #ifndef _WIN32 */
+    return;
+}
+
+/* getopt_p_convert() of each argument, with the result or the error */
+void test_convert (void)
+{
+    enum {
+        ok = getopt_p_convert_ok,
+        syntax = getopt_p_convert_syntax,
+        range = getopt_p_convert_range,
+        unit = getopt_p_convert_unit
+    };
+    static const struct {
+        int type;           /* getopt_p_type of the conversion */
+        const char * arg;   /* Argument to convert */
+        int conv;           /* Expected getopt_p_convert_error, or zero */
+        uint64_t u64;       /* Expected value, as a u64 bit pattern */
+    } cases[] = {
+        { getopt_p_type_int32, "0", ok, 0 },
+        { getopt_p_type_int32, "2147483647", ok, 2147483647 },
+        { getopt_p_type_int32, "-2147483648", ok, 0x80000000ULL },
+        { getopt_p_type_int32, "2147483648", range, 0 },
+        { getopt_p_type_int32, "-2147483649", range, 0 },
+        { getopt_p_type_int32, "+12345678", ok, 12345678 },
+        { getopt_p_type_int32, "0x7fffffff", ok, 0x7fffffff },
+        { getopt_p_type_int32, "0x80000000", range, 0 },
+        { getopt_p_type_int32, "-0x80000000", ok, 0x80000000ULL },
+        { getopt_p_type_int32, "00000000000000000001", ok, 1 },
+        { getopt_p_type_int64, "9223372036854775807", ok,
+            0x7fffffffffffffffULL },
+        { getopt_p_type_int64, "-9223372036854775808", ok,
+            0x8000000000000000ULL },
+        { getopt_p_type_int64, "9223372036854775808", range, 0 },
+        { getopt_p_type_int64, "-9223372036854775809", range, 0 },
+        { getopt_p_type_int64, "-1", ok, 0xffffffffffffffffULL },
+        { getopt_p_type_uint64, "18446744073709551615", ok,
+            0xffffffffffffffffULL },
+        { getopt_p_type_uint64, "18446744073709551616", range, 0 },
+        { getopt_p_type_uint64, "99999999999999999999999", range, 0 },
+        { getopt_p_type_uint64, "0xFFFFFFFFffffffff", ok,
+            0xffffffffffffffffULL },
+        { getopt_p_type_uint64, "0x10000000000000000", range, 0 },
+        { getopt_p_type_uint64, "0x0123456789abcdef", ok,
+            0x0123456789abcdefULL },
+        { getopt_p_type_uint64, "0XABCDEF", ok, 0xabcdef },
+        { getopt_p_type_uint64, "-1", syntax, 0 },
+        /* Junk, in the eight at a time and one at a time paths */
+        { getopt_p_type_uint64, "", syntax, 0 },
+        { getopt_p_type_uint64, "0x", syntax, 0 },
+        { getopt_p_type_uint64, "12345678x", syntax, 0 },
+        { getopt_p_type_uint64, "1234567/", syntax, 0 },
+        { getopt_p_type_uint64, "1234567:", syntax, 0 },
+        { getopt_p_type_uint64, "123 4567", syntax, 0 },
+        { getopt_p_type_uint64, "0x1234567g", syntax, 0 },
+        { getopt_p_type_uint64, "0x1234567`", syntax, 0 },
+        { getopt_p_type_uint64, "0x\x10\x11\x12", syntax, 0 },
+        { getopt_p_type_uint64,
+            "0x\x10\x11\x12\x13\x14\x15\x16\x17", syntax, 0 },
+        { getopt_p_type_uint64, "0x1234\x19" "567", syntax, 0 },
+        { getopt_p_type_uint64, "\x80" "1234567", syntax, 0 },
+        { getopt_p_type_uint64,
+            "0x\xe1\xe2\xe3\xe4\xe5\xe6\xe7\xe8", syntax, 0 },
+        { getopt_p_type_uint64, "99999999999999999999x", syntax, 0 },
+        /* Sizes and durations, with and without a unit */
+        { getopt_p_type_size, "512", ok, 512 },
+        { getopt_p_type_size, "4KiB", ok, 4096 },
+        { getopt_p_type_size, "4K", ok, 4096 },
+        { getopt_p_type_size, "4kB", ok, 4000 },
+        { getopt_p_type_size, "512M", ok, 512ULL << 20 },
+        { getopt_p_type_size, "2GB", ok, 2000000000ULL },
+        { getopt_p_type_size, "1TiB", ok, 1ULL << 40 },
+        { getopt_p_type_size, "16777215T", ok, 16777215ULL << 40 },
+        { getopt_p_type_size, "16777216T", range, 0 },
+        { getopt_p_type_size, "5XB", unit, 0 },
+        { getopt_p_type_size, "5KiBB", unit, 0 },
+        { getopt_p_type_size, "K", syntax, 0 },
+        { getopt_p_type_duration, "1500ms", ok, 1500000000ULL },
+        { getopt_p_type_duration, "2", ok, 2000000000ULL },
+        { getopt_p_type_duration, "250us", ok, 250000 },
+        { getopt_p_type_duration, "7ns", ok, 7 },
+        { getopt_p_type_duration, "3m", ok, 180000000000ULL },
+        { getopt_p_type_duration, "1h", ok, 3600000000000ULL },
+        { getopt_p_type_duration, "5124095h", ok,
+            5124095ULL * 3600000000000ULL },
+        { getopt_p_type_duration, "5124096h", range, 0 },
+        { getopt_p_type_duration, "1d", unit, 0 },
+        { getopt_p_type_duration, "1MS", unit, 0 },
+        { getopt_p_type_bool, "Yes", ok, 1 },
+        { getopt_p_type_bool, "off", ok, 0 },
+        { getopt_p_type_bool, "2", syntax, 0 }
+    };
+    char name[64];
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        getopt_p_value value;
+        memset(&value, 0, sizeof(value));
+        int conv = getopt_p_convert(cases[i].type, cases[i].arg, &value);
+        uint64_t u64 = (cases[i].type == getopt_p_type_int32) ?
+            (uint64_t)(uint32_t)value.i32 :
+            (cases[i].type == getopt_p_type_bool) ?
+            (uint64_t)value.boolean : value.u64;
+        (void)snprintf(name, sizeof(name), "convert case %u", (unsigned)i);
+        TEST_CHECK(conv == cases[i].conv, name);
+        TEST_CHECK(conv != 0 || u64 == cases[i].u64, name);
+    }
+    return;
+}
+
+/* Records of a permuted parse give the index of the entry once permuted */
+void test_permute_records (void)
+{
+    char * argv[] = { "p", "f1", "-ab", "f2", "-c", "x", "f3", "-a", NULL };
+    const char * permuted[] = { "p", "-ab", "-c", "x", "-a", "f1", "f2",
+        "f3" };
+    const char options[] = { 'a', 'b', 'c', 'a' };
+    int argv_idx[] = { 1, 1, 2, 4 };
+    char * operands[8];
+    getopt_p_table table;
+    getopt_p_compile(&table, "abc:");
+    getopt_p_state state = GETOPT_P_STATE_INIT;
+    state.operands = operands;
+    state.operands_max = 8;
+    getopt_p_result results[8];
+    int len = 0;
+    int first = getopt_p_parse_all(&state, 8, argv, &table, results, 8,
+        &len);
+    TEST_CHECK(first == 5 && len == 4, "permute records");
+    for (int i = 0; i < 8; i++) {
+        TEST_CHECK(strcmp(argv[i], permuted[i]) == 0, "permute records");
+    }
+    for (int i = 0; i < len && i < 4; i++) {
+        TEST_CHECK(results[i].option == options[i], "permute records");
+        TEST_CHECK(results[i].argv_idx == argv_idx[i], "permute records");
+        TEST_CHECK(strchr(argv[results[i].argv_idx], options[i]) != NULL,
+            "permute records");
+    }
+    return;
+}
+
+/* getopt_long() indexes an array refilled between parses again */
+void test_long_refill (void)
+{
+    static char names[100][16];
+    static getopt_p_option longopts[101];
+    int lost = 0;
+    for (int count = 10; count <= 100; count *= 10) {
+        for (int i = 0; i < count; i++) {
+            (void)snprintf(names[i], sizeof(names[i]), "opt-%d", i);
+            getopt_p_option option = { names[i], 0, NULL, i };
+            longopts[i] = option;
+        }
+        getopt_p_option end = { NULL, 0, NULL, 0 };
+        longopts[count] = end;
+        for (int i = 0; i < count; i++) {
+            char arg[24];
+            (void)snprintf(arg, sizeof(arg), "--%s", names[i]);
+            char * argv[] = { "prog", arg, NULL };
+            GETOPT_P_NAME(optind) = 1;
+            lost += (GETOPT_P_NAME(getopt_long)(2, argv, "", longopts,
+                NULL) != i);
+        }
+    }
+    TEST_CHECK(lost == 0, "long refill");
+    return;
+}
@@ -0,0 +1,226 @@
+/*
+test_glibc.c
+Differential test of the "getop_p.h" getopt() variants against glibc.
+SPDX-License-Identifier: Unlicense OR 0BSD
+
+The portable implementation is built with GETOPT_P_FORCE_PORTABLE and run
+side by side with the glibc getopt(), getopt_long() and getopt_long_only()
+on random argv vectors. Option strings cover '::', a leading '-' or ':',
+and both permuting and not. Every return value, optind, optarg, optopt
+(for errors), longindex, flag and the final argv must match. The program
+prints the first mismatches and exits non-zero if there are any :
+
+    cc -o test_glibc test_glibc.c && ./test_glibc [runs] [seed]
+*/
+
+#define _GNU_SOURCE                 /* glibc getopt_long() */
+#define GETOPT_P_FORCE_PORTABLE
+#define GETOPT_P_IMPLEMENTATION
+#include "getopt_p.h"
+
+#include <getopt.h>                 /* Platform getopt_long() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_ARGC_MAX 12            /* Most entries of a random argv */
+#define TEST_CALLS_MAX 64           /* Most calls before a parse must end */
+#define TEST_MISMATCHES_MAX 10      /* Mismatches printed before stopping */
+
+/* How one random argv is parsed */
+enum test_mode {
+    test_mode_getopt = 0,           /* getopt() */
+    test_mode_long = 1,             /* getopt_long() */
+    test_mode_long_only = 2,        /* getopt_long_only() */
+    test_modes = 3
+};
+
+/* Entries a random argv is made of, chosen to reach every branch */
+static const char * test_entries[] = {
+    "-a", "-b", "-ab", "-ba", "-abc", "-c", "-cval", "-acval", "-O", "-O2",
+    "-aO", "-aO3", "-Oa", "-x", "-ax", "-xa", "-", "--", "file", "f2",
+    "-:", "-?", "--verbose", "--verb", "--verbatim", "--ver", "--file",
+    "--file=name", "--fi", "--color", "--color=red", "--col", "--nope",
+    "--verbose=1", "-verbose", "-verb", "-file", "-f", "-fname", "-col",
+    "-color=blue", "-cv", "-v", "-=", "--=x", "---"
+};
+#define TEST_ENTRIES (sizeof(test_entries) / sizeof(test_entries[0]))
+
+/* Option strings; '+' is added for glibc when not permuting */
+static const char * test_opt_strs[] = {
+    "abc:O::", ":abc:O::", "-abc:O::", "-:abc:O::", "abc:O::v", "ab:c::",
+    ":vf:O::", "-vf:"
+};
+#define TEST_OPT_STRS (sizeof(test_opt_strs) / sizeof(test_opt_strs[0]))
+
+static int test_glibc_flag;
+static int test_portable_flag;
+
+static const struct option test_glibc_longopts[] = {
+    { "verbose", no_argument, NULL, 'v' },
+    { "verbatim", no_argument, NULL, 'V' },
+    { "file", required_argument, NULL, 'f' },
+    { "color", optional_argument, &test_glibc_flag, 1 },
+    { NULL, 0, NULL, 0 }
+};
+
+static const getopt_p_option test_portable_longopts[] = {
+    { "verbose", getopt_p_no_argument, NULL, 'v' },
+    { "verbatim", getopt_p_no_argument, NULL, 'V' },
+    { "file", getopt_p_required_argument, NULL, 'f' },
+    { "color", getopt_p_optional_argument, &test_portable_flag, 1 },
+    { NULL, 0, NULL, 0 }
+};
+
+static unsigned long long test_rng_state;
+static long test_mismatches = 0;
+
+unsigned test_random (unsigned range);
+void test_run (long run);
+void test_mismatch (long run, const char * what, int mode, int permute,
+    const char * opt_str, int argc, char * const argv[], int call);
+
+int main (int argc, char * argv[])
+{
+#ifndef __GLIBC__
+    printf("Not glibc, nothing to compare with\n");
+    return 0;
+#endif /* #ifndef __GLIBC__ */
+    long runs = (argc > 1) ? atol(argv[1]) : 100000L;
+    test_rng_state = (argc > 2) ? strtoull(argv[2], NULL, 0) : 1;
+    if (test_rng_state == 0) {
+        test_rng_state = 1;
+    }
+    opterr = 0;
+    getopt_p_opterr = 0;
+
+    for (long run = 0; run < runs &&
+        test_mismatches < TEST_MISMATCHES_MAX; run++) {
+        test_run(run);
+    }
+    if (test_mismatches != 0) {
+        printf("%ld mismatches\n", test_mismatches);
+        return 1;
+    }
+    printf("%ld runs matched glibc\n", runs);
+    return 0;
+}
+
+/* xorshift64, good enough to pick entries */
+unsigned test_random (unsigned range)
+{
+    test_rng_state ^= test_rng_state << 13;
+    test_rng_state ^= test_rng_state >> 7;
+    test_rng_state ^= test_rng_state << 17;
+    return (unsigned)(test_rng_state % range);
+}
+
+/* Parse one random argv with both implementations, comparing each call */
+void test_run (long run)
+{
+    char * glibc_argv[TEST_ARGC_MAX+1];
+    char * portable_argv[TEST_ARGC_MAX+1];
+    char * start_argv[TEST_ARGC_MAX+1];
+    char * operands[TEST_ARGC_MAX];
+    int argc = 1 + (int)test_random(TEST_ARGC_MAX);
+    start_argv[0] = "prog";
+    for (int i = 1; i < argc; i++) {
+        start_argv[i] = (char *)test_entries[test_random(TEST_ENTRIES)];
+    }
+    start_argv[argc] = NULL;
+    memcpy(glibc_argv, start_argv, sizeof(start_argv));
+    memcpy(portable_argv, start_argv, sizeof(start_argv));
+
+    const char * opt_str = test_opt_strs[test_random(TEST_OPT_STRS)];
+    int mode = (int)test_random(test_modes);
+    int permute = (opt_str[0] != '-') && (int)test_random(2);
+
+    /* glibc permutes unless told not to by '+' */
+    char glibc_opt_str[32];
+    (void)snprintf(glibc_opt_str, sizeof(glibc_opt_str), "%s%s",
+        (permute || opt_str[0] == '-') ? "" : "+", opt_str);
+    getopt_p_set_permute(permute ? operands : NULL,
+        permute ? TEST_ARGC_MAX : 0);
+
+    optind = 0;             /* Both reinitialise on optind = 0 */
+    getopt_p_optind = 0;
+    test_glibc_flag = 0;
+    test_portable_flag = 0;
+    for (int call = 0; call < TEST_CALLS_MAX; call++) {
+        int glibc_index = -1;
+        int portable_index = -1;
+        int glibc_c;
+        int portable_c;
+        optarg = NULL;
+        if (mode == test_mode_getopt) {
+            glibc_c = getopt(argc, glibc_argv, glibc_opt_str);
+            portable_c = getopt_p_getopt(argc, portable_argv, opt_str);
+        } else if (mode == test_mode_long) {
+            glibc_c = getopt_long(argc, glibc_argv, glibc_opt_str,
+                test_glibc_longopts, &glibc_index);
+            portable_c = getopt_p_getopt_long(argc, portable_argv, opt_str,
+                test_portable_longopts, &portable_index);
+        } else {
+            glibc_c = getopt_long_only(argc, glibc_argv, glibc_opt_str,
+                test_glibc_longopts, &glibc_index);
+            portable_c = getopt_p_getopt_long_only(argc, portable_argv,
+                opt_str, test_portable_longopts, &portable_index);
+        }
+
+        if (glibc_c != portable_c) {
+            test_mismatch(run, "return value", mode, permute, opt_str, argc,
+                start_argv, call);
+            return;
+        }
+        if (optind != getopt_p_optind) {
+            test_mismatch(run, "optind", mode, permute, opt_str, argc,
+                start_argv, call);
+            return;
+        }
+        if (glibc_c == -1) {
+            break;
+        }
+        if ((optarg == NULL) != (getopt_p_optarg == NULL) ||
+            (optarg != NULL && strcmp(optarg, getopt_p_optarg) != 0)) {
+            test_mismatch(run, "optarg", mode, permute, opt_str, argc,
+                start_argv, call);
+            return;
+        }
+        if ((glibc_c == '?' || glibc_c == ':') && optopt != getopt_p_optopt) {
+            test_mismatch(run, "optopt", mode, permute, opt_str, argc,
+                start_argv, call);
+            return;
+        }
+        if (glibc_index != portable_index ||
+            test_glibc_flag != test_portable_flag) {
+            test_mismatch(run, "longindex or flag", mode, permute, opt_str,
+                argc, start_argv, call);
+            return;
+        }
+    }
+
+    /* A permuted argv must end up in the same order */
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(glibc_argv[i], portable_argv[i]) != 0) {
+            test_mismatch(run, "final argv", mode, permute, opt_str, argc,
+                start_argv, -1);
+            return;
+        }
+    }
+    return;
+}
+
+void test_mismatch (long run, const char * what, int mode, int permute,
+    const char * opt_str, int argc, char * const argv[], int call)
+{
+    static const char * mode_names[] = { "getopt", "getopt_long",
+        "getopt_long_only" };
+    printf("Run %ld : %s differs at call %d of %s(\"%s\")%s :", run, what,
+        call, mode_names[mode], opt_str, permute ? " permuting" : "");
+    for (int i = 1; i < argc; i++) {
+        printf(" %s", argv[i]);
+    }
+    printf("\n");
+    test_mismatches++;
+    return;
+}